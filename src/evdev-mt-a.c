@@ -0,0 +1,307 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Conversion of the anonymous multitouch protocol A into the slotted
+ * protocol B. Contacts of a protocol A frame are collected until
+ * SYN_REPORT, matched against the contacts of the previous frame and
+ * emitted as slot updates. All state is kept in a fixed size structure
+ * allocated once per device, so the conversion itself never allocates.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <linux/input.h>
+
+#include "evdev.h"
+
+/* A slot may be released and reused within one frame, which takes at
+ * most six events: slot and tracking id for the release, followed by
+ * slot, tracking id, x and y for the new contact. The frame is terminated
+ * by SYN_REPORT. */
+#define MT_A_MAX_EVENTS (MAX_SLOTS * 6 + 1)
+
+struct mt_a_contact {
+	int32_t x, y;
+};
+
+struct evdev_mt_a {
+	/* Contact currently being reported. */
+	struct mt_a_contact contact;
+	int contact_valid;
+
+	/* Contacts of the frame currently being reported. */
+	struct mt_a_contact frame[MAX_SLOTS];
+	int frame_count;
+
+	struct {
+		int32_t tracking_id;
+		int32_t x, y;
+	} slots[MAX_SLOTS];
+	int32_t next_tracking_id;
+	int slot;
+
+	struct input_event events[MT_A_MAX_EVENTS];
+	int events_count;
+};
+
+struct evdev_mt_a *
+evdev_mt_a_create(void)
+{
+	struct evdev_mt_a *mt_a;
+	int i;
+
+	mt_a = zalloc(sizeof *mt_a);
+	if (!mt_a)
+		return NULL;
+
+	for (i = 0; i < MAX_SLOTS; i++)
+		mt_a->slots[i].tracking_id = -1;
+
+	return mt_a;
+}
+
+void
+evdev_mt_a_destroy(struct evdev_mt_a *mt_a)
+{
+	free(mt_a);
+}
+
+static void
+mt_a_emit(struct evdev_mt_a *mt_a,
+	  const struct input_event *report,
+	  uint16_t code, int32_t value)
+{
+	struct input_event *e = &mt_a->events[mt_a->events_count++];
+
+	e->time = report->time;
+	e->type = EV_ABS;
+	e->code = code;
+	e->value = value;
+}
+
+static void
+mt_a_emit_slot(struct evdev_mt_a *mt_a,
+	       const struct input_event *report,
+	       int slot)
+{
+	if (mt_a->slot == slot)
+		return;
+
+	mt_a_emit(mt_a, report, ABS_MT_SLOT, slot);
+	mt_a->slot = slot;
+}
+
+static void
+mt_a_update_slot(struct evdev_mt_a *mt_a,
+		 const struct input_event *report,
+		 int slot,
+		 const struct mt_a_contact *contact)
+{
+	if (mt_a->slots[slot].x != contact->x) {
+		mt_a_emit_slot(mt_a, report, slot);
+		mt_a_emit(mt_a, report, ABS_MT_POSITION_X, contact->x);
+		mt_a->slots[slot].x = contact->x;
+	}
+	if (mt_a->slots[slot].y != contact->y) {
+		mt_a_emit_slot(mt_a, report, slot);
+		mt_a_emit(mt_a, report, ABS_MT_POSITION_Y, contact->y);
+		mt_a->slots[slot].y = contact->y;
+	}
+}
+
+static void
+mt_a_begin_slot(struct evdev_mt_a *mt_a,
+		const struct input_event *report,
+		int slot,
+		const struct mt_a_contact *contact)
+{
+	mt_a->slots[slot].tracking_id = mt_a->next_tracking_id;
+	mt_a->next_tracking_id =
+		(mt_a->next_tracking_id + 1) & 0xffff;
+
+	mt_a_emit_slot(mt_a, report, slot);
+	mt_a_emit(mt_a, report, ABS_MT_TRACKING_ID,
+		  mt_a->slots[slot].tracking_id);
+	mt_a_emit(mt_a, report, ABS_MT_POSITION_X, contact->x);
+	mt_a_emit(mt_a, report, ABS_MT_POSITION_Y, contact->y);
+	mt_a->slots[slot].x = contact->x;
+	mt_a->slots[slot].y = contact->y;
+}
+
+static void
+mt_a_end_slot(struct evdev_mt_a *mt_a,
+	      const struct input_event *report,
+	      int slot)
+{
+	mt_a->slots[slot].tracking_id = -1;
+
+	mt_a_emit_slot(mt_a, report, slot);
+	mt_a_emit(mt_a, report, ABS_MT_TRACKING_ID, -1);
+}
+
+/* Match the contacts of the new frame against the active slots by
+ * repeatedly pairing the globally closest unmatched slot and contact.
+ * With at most MAX_SLOTS contacts on either side, the squared distances
+ * fit in a small matrix on the stack, and each pass is a scan of that
+ * matrix. */
+static void
+mt_a_match_frame(struct evdev_mt_a *mt_a,
+		 int slot_for_contact[MAX_SLOTS])
+{
+	uint64_t dist[MAX_SLOTS][MAX_SLOTS];
+	int slot_matched[MAX_SLOTS];
+	int active[MAX_SLOTS];
+	int nactive = 0;
+	int i, j, best_i, best_j;
+	int64_t dx, dy;
+	uint64_t best;
+
+	for (i = 0; i < MAX_SLOTS; i++) {
+		slot_matched[i] = 0;
+		if (mt_a->slots[i].tracking_id >= 0)
+			active[nactive++] = i;
+	}
+
+	for (j = 0; j < mt_a->frame_count; j++) {
+		slot_for_contact[j] = -1;
+		for (i = 0; i < nactive; i++) {
+			dx = mt_a->frame[j].x - mt_a->slots[active[i]].x;
+			dy = mt_a->frame[j].y - mt_a->slots[active[i]].y;
+			dist[i][j] = dx * dx + dy * dy;
+		}
+	}
+
+	for (;;) {
+		best = UINT64_MAX;
+		best_i = -1;
+		best_j = -1;
+
+		for (i = 0; i < nactive; i++) {
+			if (slot_matched[i])
+				continue;
+			for (j = 0; j < mt_a->frame_count; j++) {
+				if (slot_for_contact[j] != -1)
+					continue;
+				if (dist[i][j] < best) {
+					best = dist[i][j];
+					best_i = i;
+					best_j = j;
+				}
+			}
+		}
+
+		if (best_i == -1)
+			break;
+
+		slot_matched[best_i] = 1;
+		slot_for_contact[best_j] = active[best_i];
+	}
+}
+
+static void
+mt_a_process_frame(struct evdev_mt_a *mt_a,
+		   const struct input_event *report)
+{
+	int slot_for_contact[MAX_SLOTS];
+	int slot_in_use[MAX_SLOTS];
+	int i, j;
+
+	mt_a_match_frame(mt_a, slot_for_contact);
+
+	memset(slot_in_use, 0, sizeof slot_in_use);
+	for (j = 0; j < mt_a->frame_count; j++) {
+		if (slot_for_contact[j] == -1)
+			continue;
+
+		slot_in_use[slot_for_contact[j]] = 1;
+		mt_a_update_slot(mt_a, report,
+				 slot_for_contact[j], &mt_a->frame[j]);
+	}
+
+	for (i = 0; i < MAX_SLOTS; i++) {
+		if (mt_a->slots[i].tracking_id >= 0 && !slot_in_use[i])
+			mt_a_end_slot(mt_a, report, i);
+	}
+
+	for (j = 0; j < mt_a->frame_count; j++) {
+		if (slot_for_contact[j] != -1)
+			continue;
+
+		for (i = 0; i < MAX_SLOTS; i++) {
+			if (mt_a->slots[i].tracking_id < 0)
+				break;
+		}
+		mt_a_begin_slot(mt_a, report, i, &mt_a->frame[j]);
+	}
+
+	mt_a->frame_count = 0;
+	mt_a->contact_valid = 0;
+}
+
+int
+evdev_mt_a_convert(struct evdev_mt_a *mt_a,
+		   struct input_event *e,
+		   struct input_event **events)
+{
+	switch (e->type) {
+	case EV_ABS:
+		switch (e->code) {
+		case ABS_MT_POSITION_X:
+			mt_a->contact.x = e->value;
+			mt_a->contact_valid = 1;
+			return 0;
+		case ABS_MT_POSITION_Y:
+			mt_a->contact.y = e->value;
+			mt_a->contact_valid = 1;
+			return 0;
+		}
+
+		/* The remaining protocol A axes are not used. */
+		if (e->code >= ABS_MT_SLOT && e->code <= ABS_MAX)
+			return 0;
+		break;
+	case EV_SYN:
+		switch (e->code) {
+		case SYN_MT_REPORT:
+			if (mt_a->contact_valid &&
+			    mt_a->frame_count < MAX_SLOTS)
+				mt_a->frame[mt_a->frame_count++] =
+					mt_a->contact;
+			mt_a->contact_valid = 0;
+			return 0;
+		case SYN_REPORT:
+			mt_a->events_count = 0;
+			mt_a_process_frame(mt_a, e);
+			mt_a->events[mt_a->events_count++] = *e;
+
+			*events = mt_a->events;
+			return mt_a->events_count;
+		}
+		break;
+	}
+
+	*events = e;
+	return 1;
+}
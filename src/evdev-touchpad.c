@@ -27,53 +27,36 @@
 #include <math.h>
 #include <string.h>
 #include <stdbool.h>
-#include <time.h>
-#include <unistd.h>
 #include <linux/input.h>
-#include <sys/timerfd.h>
 
 #include "evdev.h"
 #include "filter.h"
 #include "libinput-private.h"
+#include "touchpad-quirks.h"
 
-/* Default values */
-#define DEFAULT_CONSTANT_ACCEL_NUMERATOR 50
-#define DEFAULT_MIN_ACCEL_FACTOR 0.16
-#define DEFAULT_MAX_ACCEL_FACTOR 1.0
-#define DEFAULT_HYSTERESIS_MARGIN_DENOMINATOR 700.0
+/* Motion of touchpads reporting their resolution is normalized to this
+ * resolution (units/mm), and tuned as if the touchpad had this diagonal
+ * (mm), so the same finger motion moves the pointer equally on all of
+ * them. Others are tuned from their diagonal in device units. */
+#define TOUCHPAD_NORMALIZED_RESOLUTION 40.0
+#define TOUCHPAD_NORMALIZED_DIAGONAL 120.0
 
-#define DEFAULT_TOUCHPAD_SINGLE_TAP_BUTTON BTN_LEFT
-#define DEFAULT_TOUCHPAD_SINGLE_TAP_TIMEOUT 100
+/* Samples further apart than this (ms) are not fitted together; the
+ * touch rested in between. */
+#define TOUCHPAD_HISTORY_MAX_GAP 100
 
-enum touchpad_model {
-	TOUCHPAD_MODEL_UNKNOWN = 0,
-	TOUCHPAD_MODEL_SYNAPTICS,
-	TOUCHPAD_MODEL_ALPS,
-	TOUCHPAD_MODEL_APPLETOUCH,
-	TOUCHPAD_MODEL_ELANTECH
-};
+/* Kinetic scrolling slows down exponentially with this time constant (ms)
+ * and stops below the minimum speed (scroll units per ms). */
+#define TOUCHPAD_KINETIC_TIME_CONSTANT 325.0
+#define TOUCHPAD_KINETIC_MIN_SPEED 0.02
 
-enum touchpad_event {
-	TOUCHPAD_EVENT_NONE	    = 0,
-	TOUCHPAD_EVENT_ABSOLUTE_ANY = (1 << 0),
-	TOUCHPAD_EVENT_ABSOLUTE_X   = (1 << 1),
-	TOUCHPAD_EVENT_ABSOLUTE_Y   = (1 << 2),
-	TOUCHPAD_EVENT_REPORT	    = (1 << 3)
-};
-
-struct touchpad_model_spec {
-	short vendor;
-	short product;
-	enum touchpad_model model;
-};
+/* Scrolling fingers are rarely lifted at the same time. The velocity of
+ * scrolling that ended less than this (ms) ago is kept while the
+ * remaining finger is down, and a fling starts when it is lifted. */
+#define TOUCHPAD_KINETIC_LIFT_GRACE 150
 
-static struct touchpad_model_spec touchpad_spec_table[] = {
-	{0x0002, 0x0007, TOUCHPAD_MODEL_SYNAPTICS},
-	{0x0002, 0x0008, TOUCHPAD_MODEL_ALPS},
-	{0x05ac, 0x0000, TOUCHPAD_MODEL_APPLETOUCH},
-	{0x0002, 0x000e, TOUCHPAD_MODEL_ELANTECH},
-	{0x0000, 0x0000, TOUCHPAD_MODEL_UNKNOWN}
-};
+#define DEFAULT_TOUCHPAD_SINGLE_TAP_BUTTON BTN_LEFT
+#define DEFAULT_TOUCHPAD_SINGLE_TAP_TIMEOUT 100
 
 enum touchpad_state {
 	TOUCHPAD_STATE_NONE  = 0,
@@ -81,11 +64,25 @@ enum touchpad_state {
 	TOUCHPAD_STATE_MOVE  = (1 << 1)
 };
 
-#define TOUCHPAD_HISTORY_LENGTH 4
+/* Accelerated motion below the fixed point precision. */
+struct touchpad_remainder {
+	double dx, dy;
+};
 
-struct touchpad_motion {
+struct touchpad_touch {
+	int32_t tracking_id; /* -1 if the slot has no contact */
 	int32_t x;
 	int32_t y;
+	int dirty;
+
+	struct {
+		int32_t center_x;
+		int32_t center_y;
+	} hysteresis;
+
+	struct touchpad_motion history[TOUCHPAD_HISTORY_MAX];
+	int history_index;
+	unsigned int history_count;
 };
 
 enum touchpad_fingers_state {
@@ -94,21 +91,77 @@ enum touchpad_fingers_state {
 	TOUCHPAD_FINGERS_THREE = (1 << 2)
 };
 
-enum fsm_event {
-	FSM_EVENT_TOUCH,
-	FSM_EVENT_RELEASE,
-	FSM_EVENT_MOTION,
-	FSM_EVENT_TIMEOUT
+/* Events queued during a frame. At most a touch, a motion and a release
+ * are queued per frame, so the queue only fills up if frames are lost.
+ * The state machine is then reset, releasing the button if needed. */
+#define FSM_MAX_EVENTS 16
+
+/* The tap state machine, with a transition for every state and event.
+ * Actions are run in order; the timer is cancelled after a transition
+ * that doesn't set it. Every transition out of a state that holds the
+ * button down (FSM_TAP_PRESSED, FSM_TAP_2 and FSM_DRAG) either stays in
+ * such a state or releases the button. */
+static const struct fsm_transition
+fsm_transitions[FSM_STATE_COUNT][FSM_EVENT_COUNT] = {
+	[FSM_IDLE] = {
+		[FSM_EVENT_TOUCH] = { FSM_TOUCH },
+		[FSM_EVENT_RELEASE] = { FSM_IDLE },
+		[FSM_EVENT_MOTION] = { FSM_IDLE },
+		[FSM_EVENT_TIMEOUT] = { FSM_IDLE },
+	},
+	[FSM_TOUCH] = {
+		[FSM_EVENT_TOUCH] = { FSM_TOUCH },
+		[FSM_EVENT_RELEASE] = { FSM_TAP, { FSM_ACTION_SET_TIMER } },
+		[FSM_EVENT_MOTION] = { FSM_IDLE },
+		[FSM_EVENT_TIMEOUT] = { FSM_IDLE },
+	},
+	[FSM_TAP] = {
+		[FSM_EVENT_TOUCH] = { FSM_TAP_2, { FSM_ACTION_PRESS } },
+		[FSM_EVENT_RELEASE] = { FSM_IDLE },
+		[FSM_EVENT_MOTION] = { FSM_IDLE },
+		[FSM_EVENT_TIMEOUT] = { FSM_IDLE, { FSM_ACTION_PRESS,
+						    FSM_ACTION_RELEASE } },
+	},
+	[FSM_TAP_PRESSED] = {
+		[FSM_EVENT_TOUCH] = { FSM_TAP_2 },
+		[FSM_EVENT_RELEASE] = { FSM_IDLE, { FSM_ACTION_RELEASE } },
+		[FSM_EVENT_MOTION] = { FSM_IDLE, { FSM_ACTION_RELEASE } },
+		[FSM_EVENT_TIMEOUT] = { FSM_IDLE, { FSM_ACTION_RELEASE } },
+	},
+	[FSM_TAP_2] = {
+		[FSM_EVENT_TOUCH] = { FSM_TAP_2 },
+		[FSM_EVENT_RELEASE] = { FSM_IDLE, { FSM_ACTION_RELEASE,
+						    FSM_ACTION_PRESS,
+						    FSM_ACTION_RELEASE } },
+		[FSM_EVENT_MOTION] = { FSM_DRAG },
+		[FSM_EVENT_TIMEOUT] = { FSM_TAP_2 },
+	},
+	[FSM_DRAG] = {
+		[FSM_EVENT_TOUCH] = { FSM_DRAG },
+		[FSM_EVENT_RELEASE] = { FSM_IDLE, { FSM_ACTION_RELEASE } },
+		[FSM_EVENT_MOTION] = { FSM_DRAG },
+		[FSM_EVENT_TIMEOUT] = { FSM_DRAG },
+	},
 };
 
-enum fsm_state {
-	FSM_IDLE,
-	FSM_TOUCH,
-	FSM_TAP,
-	FSM_TAP_2,
-	FSM_DRAG
+/* With immediate taps the button is pressed when the tap is released,
+ * and FSM_TAP_PRESSED takes the place of FSM_TAP. */
+static const struct fsm_transition fsm_immediate_tap = {
+	FSM_TAP_PRESSED, { FSM_ACTION_PRESS, FSM_ACTION_SET_TIMER }
 };
 
+const struct fsm_transition *
+evdev_touchpad_fsm_transition(enum fsm_state state,
+			      enum fsm_event event,
+			      enum libinput_touchpad_tap_mode mode)
+{
+	if (state == FSM_TOUCH && event == FSM_EVENT_RELEASE &&
+	    mode == LIBINPUT_TOUCHPAD_TAP_IMMEDIATE)
+		return &fsm_immediate_tap;
+
+	return &fsm_transitions[state][event];
+}
+
 struct touchpad_dispatch {
 	struct evdev_dispatch base;
 	struct evdev_device *device;
@@ -122,29 +175,23 @@ struct touchpad_dispatch {
 	double min_accel_factor;
 	double max_accel_factor;
 
-	unsigned int event_mask;
-	unsigned int event_mask_filter;
-
 	int reset;
 
 	struct {
 		bool enable;
 
 
-		enum fsm_event *events;
-		size_t events_len;
+		enum fsm_event events[FSM_MAX_EVENTS];
 		size_t events_count;
+		bool overflow;
 		enum fsm_state state;
-		struct {
-			int fd;
-			struct libinput_source *source;
-		} timer;
+		struct libinput_timer timer;
 	} fsm;
 
-	struct {
-		int32_t x;
-		int32_t y;
-	} hw_abs;
+	/* Touchpads without slots have a single touch in slot 0. */
+	int has_mt;
+	int slot;
+	struct touchpad_touch touches[MAX_SLOTS];
 
 	int has_pressure;
 	struct {
@@ -155,55 +202,54 @@ struct touchpad_dispatch {
 	struct {
 		int32_t margin_x;
 		int32_t margin_y;
-		int32_t center_x;
-		int32_t center_y;
 	} hysteresis;
 
-	struct touchpad_motion motion_history[TOUCHPAD_HISTORY_LENGTH];
-	int motion_index;
-	unsigned int motion_count;
+	unsigned int history_length;
+
+	/* From device units to normalized units. */
+	struct {
+		double x, y;
+	} scale;
+
+	/* Pointer motion and scrolling each carry their own remainder, and
+	 * both are dropped when the number of fingers changes. */
+	struct {
+		struct touchpad_remainder pointer;
+		struct touchpad_remainder scroll;
+	} remainder;
+
+	struct {
+		double vx, vy; /* scroll units per ms */
+		uint32_t time; /* of the last scroll event */
+		uint64_t last; /* of the last kinetic scroll event */
+		struct libinput_timer timer;
+	} kinetic;
 
 	struct motion_filter *filter;
 };
 
-static enum touchpad_model
-get_touchpad_model(struct evdev_device *device)
+static int32_t
+pressure_threshold(const struct touchpad_pressure_quirk *quirk,
+		   int32_t pressure_min, int32_t pressure_max)
 {
-	struct input_id id;
-	unsigned int i;
-
-	if (ioctl(device->fd, EVIOCGID, &id) < 0)
-		return TOUCHPAD_MODEL_UNKNOWN;
-
-	for (i = 0; i < ARRAY_LENGTH(touchpad_spec_table); i++)
-		if (touchpad_spec_table[i].vendor == id.vendor &&
-		    (!touchpad_spec_table[i].product ||
-		     touchpad_spec_table[i].product == id.product))
-			return touchpad_spec_table[i].model;
+	int32_t range = pressure_max - pressure_min + 1;
 
-	return TOUCHPAD_MODEL_UNKNOWN;
+	return pressure_min + quirk->offset + range * quirk->fraction;
 }
 
 static void
 configure_touchpad_pressure(struct touchpad_dispatch *touchpad,
+			    const struct touchpad_quirks *quirks,
 			    int32_t pressure_min, int32_t pressure_max)
 {
-	int32_t range = pressure_max - pressure_min + 1;
-
 	touchpad->has_pressure = 1;
 
-	/* Magic numbers from xf86-input-synaptics */
-	switch (touchpad->model) {
-	case TOUCHPAD_MODEL_ELANTECH:
-		touchpad->pressure.touch_low = pressure_min + 1;
-		touchpad->pressure.touch_high = pressure_min + 1;
-		break;
-	default:
-		touchpad->pressure.touch_low =
-			pressure_min + range * (25.0/256.0);
-		touchpad->pressure.touch_high =
-			pressure_min + range * (30.0/256.0);
-	}
+	touchpad->pressure.touch_low =
+		pressure_threshold(&quirks->touch_low,
+				   pressure_min, pressure_max);
+	touchpad->pressure.touch_high =
+		pressure_threshold(&quirks->touch_high,
+				   pressure_min, pressure_max);
 }
 
 static double
@@ -227,20 +273,87 @@ touchpad_profile(struct motion_filter *filter,
 	return accel_factor;
 }
 
-static inline struct touchpad_motion *
-motion_history_offset(struct touchpad_dispatch *touchpad, int offset)
+static inline const struct touchpad_motion *
+history_offset(const struct touchpad_motion *history,
+	       unsigned int latest, int offset)
 {
 	int offset_index =
-		(touchpad->motion_index - offset + TOUCHPAD_HISTORY_LENGTH) %
-		TOUCHPAD_HISTORY_LENGTH;
+		(latest - offset + TOUCHPAD_HISTORY_MAX) %
+		TOUCHPAD_HISTORY_MAX;
 
-	return &touchpad->motion_history[offset_index];
+	return &history[offset_index];
 }
 
-static double
-estimate_delta(int x0, int x1, int x2, int x3)
+static inline const struct touchpad_motion *
+touch_history_offset(struct touchpad_touch *touch, int offset)
+{
+	return history_offset(touch->history, touch->history_index, offset);
+}
+
+/* Divide, rounding to the nearest integer with halves away from zero.
+ * The divisor must be positive. */
+static inline int64_t
+div_round(int64_t dividend, int64_t divisor)
 {
-	return (x0 + x1 - x2 - x3) / 4;
+	if (dividend < 0)
+		return (dividend - divisor / 2) / divisor;
+	else
+		return (dividend + divisor / 2) / divisor;
+}
+
+/* Estimate the motion of a touch since its previous sample from a least
+ * squares fit of its position over time over the count latest samples of
+ * its history, so that the estimate is smoothed over the history but not
+ * skewed by irregular report intervals. The fit is done on exact integer
+ * sums and only rounded once, to the nearest 24.8 fixed point value. */
+void
+evdev_touchpad_estimate_delta(const struct touchpad_motion *history,
+			      unsigned int latest_index,
+			      unsigned int count,
+			      li_fixed_t *dx, li_fixed_t *dy)
+{
+	const struct touchpad_motion *latest =
+		history_offset(history, latest_index, 0);
+	const struct touchpad_motion *previous =
+		history_offset(history, latest_index, 1);
+	const struct touchpad_motion *motion;
+	unsigned int i;
+	int64_t n = count;
+	int64_t t, x, y;
+	int64_t st = 0, sx = 0, sy = 0, stt = 0, stx = 0, sty = 0;
+	int64_t denominator, interval;
+
+	interval = (int32_t) (latest->time - previous->time);
+	if (n == 2 || interval <= 0)
+		goto displacement;
+
+	/* Positions and times are relative to the latest sample, so that
+	 * wrapping timestamps don't matter. The samples are at most
+	 * TOUCHPAD_HISTORY_MAX_GAP apart, which keeps the sums in range. */
+	for (i = 0; i < n; i++) {
+		motion = history_offset(history, latest_index, i);
+		t = (int32_t) (motion->time - latest->time);
+		x = motion->x - latest->x;
+		y = motion->y - latest->y;
+		st += t;
+		sx += x;
+		sy += y;
+		stt += t * t;
+		stx += t * x;
+		sty += t * y;
+	}
+
+	denominator = n * stt - st * st;
+	if (denominator == 0)
+		goto displacement;
+
+	*dx = div_round((n * stx - st * sx) * interval * 256, denominator);
+	*dy = div_round((n * sty - st * sy) * interval * 256, denominator);
+	return;
+
+displacement:
+	*dx = li_fixed_from_int(latest->x - previous->x);
+	*dy = li_fixed_from_int(latest->y - previous->y);
 }
 
 static int
@@ -257,32 +370,148 @@ hysteresis(int in, int center, int margin)
 	return center + diff;
 }
 
+static inline struct touchpad_touch *
+touchpad_current_touch(struct touchpad_dispatch *touchpad)
+{
+	if (touchpad->slot < 0 || touchpad->slot >= MAX_SLOTS)
+		return NULL;
+
+	return &touchpad->touches[touchpad->slot];
+}
+
 static void
-touchpad_get_delta(struct touchpad_dispatch *touchpad, double *dx, double *dy)
+touch_begin(struct touchpad_touch *touch, int32_t tracking_id)
 {
-	*dx = estimate_delta(motion_history_offset(touchpad, 0)->x,
-			     motion_history_offset(touchpad, 1)->x,
-			     motion_history_offset(touchpad, 2)->x,
-			     motion_history_offset(touchpad, 3)->x);
-	*dy = estimate_delta(motion_history_offset(touchpad, 0)->y,
-			     motion_history_offset(touchpad, 1)->y,
-			     motion_history_offset(touchpad, 2)->y,
-			     motion_history_offset(touchpad, 3)->y);
+	touch->tracking_id = tracking_id;
+	touch->history_count = 0;
+	touch->dirty = 1;
 }
 
+static void
+touch_update_history(struct touchpad_dispatch *touchpad,
+		     struct touchpad_touch *touch,
+		     uint32_t time)
+{
+	struct touchpad_motion *motion;
+
+	/* Avoid noise by moving center only when delta reaches a threshold
+	 * distance from the old center. */
+	if (touch->history_count > 0) {
+		touch->hysteresis.center_x =
+			hysteresis(touch->x,
+				   touch->hysteresis.center_x,
+				   touchpad->hysteresis.margin_x);
+		touch->hysteresis.center_y =
+			hysteresis(touch->y,
+				   touch->hysteresis.center_y,
+				   touchpad->hysteresis.margin_y);
+	} else {
+		touch->hysteresis.center_x = touch->x;
+		touch->hysteresis.center_y = touch->y;
+	}
+
+	/* Only keep the last sample if the touch rested in between. */
+	if (touch->history_count > 1 &&
+	    time - touch_history_offset(touch, 0)->time >
+	    TOUCHPAD_HISTORY_MAX_GAP)
+		touch->history_count = 1;
+
+	touch->history_index =
+		(touch->history_index + 1) % TOUCHPAD_HISTORY_MAX;
+	motion = &touch->history[touch->history_index];
+	motion->x = touch->hysteresis.center_x;
+	motion->y = touch->hysteresis.center_y;
+	motion->time = time;
+	if (touch->history_count < touchpad->history_length)
+		touch->history_count++;
+
+	touch->dirty = 0;
+}
+
+/* The motion of the centroid of the touches, i.e. the mean of the motion
+ * of each touch with at least two samples. Returns the number of touches
+ * the delta was estimated from. */
+static int
+touchpad_get_delta(struct touchpad_dispatch *touchpad,
+		   li_fixed_t *dx, li_fixed_t *dy)
+{
+	struct touchpad_touch *touch;
+	li_fixed_t touch_dx, touch_dy;
+	int i, n = 0;
+
+	*dx = 0;
+	*dy = 0;
+
+	for (i = 0; i < MAX_SLOTS; i++) {
+		touch = &touchpad->touches[i];
+		if (touch->tracking_id == -1 ||
+		    touch->history_count < 2)
+			continue;
+
+		evdev_touchpad_estimate_delta(touch->history,
+					      touch->history_index,
+					      touch->history_count,
+					      &touch_dx, &touch_dy);
+		*dx += touch_dx;
+		*dy += touch_dy;
+		n++;
+	}
+
+	if (n > 1) {
+		*dx /= n;
+		*dy /= n;
+	}
+
+	return n;
+}
+
+static void
+touchpad_reset_remainders(struct touchpad_dispatch *touchpad)
+{
+	memset(&touchpad->remainder, 0, sizeof touchpad->remainder);
+}
+
+/* The remainder of the stream the motion of the current fingers goes to,
+ * or NULL if it isn't sent anywhere. */
+static struct touchpad_remainder *
+touchpad_current_remainder(struct touchpad_dispatch *touchpad)
+{
+	switch (touchpad->finger_state) {
+	case TOUCHPAD_FINGERS_ONE:
+		return &touchpad->remainder.pointer;
+	case TOUCHPAD_FINGERS_TWO:
+		return &touchpad->remainder.scroll;
+	default:
+		return NULL;
+	}
+}
+
+/* The part of the accelerated motion below the fixed point precision is
+ * carried over to the next frame of the same stream rather than rounded
+ * away. */
 static void
 filter_motion(struct touchpad_dispatch *touchpad,
-	      double *dx, double *dy, uint32_t time)
+	      li_fixed_t *dx, li_fixed_t *dy, uint32_t time)
 {
+	struct touchpad_remainder *remainder =
+		touchpad_current_remainder(touchpad);
 	struct motion_params motion;
 
-	motion.dx = *dx;
-	motion.dy = *dy;
+	motion.dx = li_fixed_to_double(*dx) * touchpad->scale.x;
+	motion.dy = li_fixed_to_double(*dy) * touchpad->scale.y;
 
 	filter_dispatch(touchpad->filter, &motion, touchpad, time);
 
-	*dx = motion.dx;
-	*dy = motion.dy;
+	if (remainder) {
+		motion.dx += remainder->dx;
+		motion.dy += remainder->dy;
+	}
+	*dx = li_fixed_from_double(motion.dx);
+	*dy = li_fixed_from_double(motion.dy);
+	if (remainder) {
+		remainder->dx = motion.dx - li_fixed_to_double(*dx);
+		remainder->dy = motion.dy - li_fixed_to_double(*dy);
+	}
 }
 
 static void
@@ -305,108 +534,66 @@ notify_button_released(struct touchpad_dispatch *touchpad, uint32_t time)
 		LIBINPUT_POINTER_BUTTON_STATE_RELEASED);
 }
 
-static void
-notify_tap(struct touchpad_dispatch *touchpad, uint32_t time)
-{
-	notify_button_pressed(touchpad, time);
-	notify_button_released(touchpad, time);
-}
-
 static void
 process_fsm_events(struct touchpad_dispatch *touchpad, uint32_t time)
 {
-	uint32_t timeout = UINT32_MAX;
-	enum fsm_event event;
-	unsigned int i;
+	const struct fsm_transition *transition;
+	struct evdev_device *device = touchpad->device;
+	uint32_t timeout;
+	int set_timer = 0;
+	unsigned int i, j;
 
 	if (!touchpad->fsm.enable)
 		return;
 
-	if (touchpad->fsm.events_count == 0)
+	if (touchpad->fsm.events_count == 0 && !touchpad->fsm.overflow)
 		return;
 
+	if (touchpad->fsm.overflow) {
+		if (touchpad->fsm.state == FSM_TAP_PRESSED ||
+		    touchpad->fsm.state == FSM_TAP_2 ||
+		    touchpad->fsm.state == FSM_DRAG)
+			notify_button_released(touchpad, time);
+		touchpad->fsm.state = FSM_IDLE;
+		touchpad->fsm.overflow = false;
+	}
+
 	for (i = 0; i < touchpad->fsm.events_count; ++i) {
-		event = touchpad->fsm.events[i];
-		timeout = 0;
-
-		switch (touchpad->fsm.state) {
-		case FSM_IDLE:
-			switch (event) {
-			case FSM_EVENT_TOUCH:
-				touchpad->fsm.state = FSM_TOUCH;
-				break;
-			default:
-				break;
-			}
-			break;
-		case FSM_TOUCH:
-			switch (event) {
-			case FSM_EVENT_RELEASE:
-				timeout = DEFAULT_TOUCHPAD_SINGLE_TAP_TIMEOUT;
-				touchpad->fsm.state = FSM_TAP;
+		transition = evdev_touchpad_fsm_transition(
+					touchpad->fsm.state,
+					touchpad->fsm.events[i],
+					device->tap.mode);
+		set_timer = 0;
+
+		for (j = 0; j < FSM_MAX_ACTIONS; j++) {
+			switch (transition->actions[j]) {
+			case FSM_ACTION_NONE:
 				break;
-			default:
-				touchpad->fsm.state = FSM_IDLE;
+			case FSM_ACTION_SET_TIMER:
+				set_timer = 1;
 				break;
-			}
-			break;
-		case FSM_TAP:
-			switch (event) {
-			case FSM_EVENT_TIMEOUT:
-				notify_tap(touchpad, time);
-				touchpad->fsm.state = FSM_IDLE;
-				break;
-			case FSM_EVENT_TOUCH:
+			case FSM_ACTION_PRESS:
 				notify_button_pressed(touchpad, time);
-				touchpad->fsm.state = FSM_TAP_2;
-				break;
-			default:
-				touchpad->fsm.state = FSM_IDLE;
-				break;
-			}
-			break;
-		case FSM_TAP_2:
-			switch (event) {
-			case FSM_EVENT_MOTION:
-				touchpad->fsm.state = FSM_DRAG;
 				break;
-			case FSM_EVENT_RELEASE:
+			case FSM_ACTION_RELEASE:
 				notify_button_released(touchpad, time);
-				notify_tap(touchpad, time);
-				touchpad->fsm.state = FSM_IDLE;
-				break;
-			default:
-				touchpad->fsm.state = FSM_IDLE;
-				break;
-			}
-			break;
-		case FSM_DRAG:
-			switch (event) {
-			case FSM_EVENT_RELEASE:
-				notify_button_released(touchpad, time);
-				touchpad->fsm.state = FSM_IDLE;
-				break;
-			default:
-				touchpad->fsm.state = FSM_IDLE;
 				break;
 			}
-			break;
-		default:
-			touchpad->fsm.state = FSM_IDLE;
-			break;
 		}
-	}
 
-	if (timeout != UINT32_MAX) {
-		struct itimerspec its;
-
-		its.it_interval.tv_sec = 0;
-		its.it_interval.tv_nsec = 0;
-		its.it_value.tv_sec = timeout / 1000;
-		its.it_value.tv_nsec = (timeout % 1000) * 1000 * 1000;
-		timerfd_settime(touchpad->fsm.timer.fd, 0, &its, NULL);
+		touchpad->fsm.state = transition->next;
 	}
 
+	/* Only the transition of the last event decides the timer. */
+	if (set_timer) {
+		timeout = device->tap.timeout;
+		if (timeout == 0)
+			timeout = DEFAULT_TOUCHPAD_SINGLE_TAP_TIMEOUT;
+		libinput_timer_set(&touchpad->fsm.timer,
+				   libinput_now() + timeout);
+	} else
+		libinput_timer_cancel(&touchpad->fsm.timer);
+
 	touchpad->fsm.events_count = 0;
 }
 
@@ -414,71 +601,146 @@ static void
 push_fsm_event(struct touchpad_dispatch *touchpad,
 	       enum fsm_event event)
 {
-	enum fsm_event *events;
-	size_t new_len = touchpad->fsm.events_len;
-
 	if (!touchpad->fsm.enable)
 		return;
 
-	if (touchpad->fsm.events_count + 1 >= touchpad->fsm.events_len) {
-		if (new_len == 0)
-			new_len = 4;
-		else
-			new_len *= 2;
-		events = realloc(touchpad->fsm.events,
-				 sizeof(enum fsm_event) * new_len);
-		if (!events) {
-			touchpad->fsm.state = FSM_IDLE;
-			return;
-		}
-
-		touchpad->fsm.events = events;
-		touchpad->fsm.events_len = new_len;
+	if (touchpad->fsm.events_count == FSM_MAX_EVENTS) {
+		touchpad->fsm.events_count = 0;
+		touchpad->fsm.overflow = true;
+		return;
 	}
 
 	touchpad->fsm.events[touchpad->fsm.events_count++] = event;
 }
 
 static void
-fsm_timeout_handler(void *data)
+fsm_timeout_handler(uint64_t now, void *data)
 {
 	struct touchpad_dispatch *touchpad = data;
-	uint64_t expires;
-	int len;
-	struct timespec ts;
-	uint32_t now;
-
-	len = read(touchpad->fsm.timer.fd, &expires, sizeof expires);
-	if (len != sizeof expires)
-		/* This will only happen if the application made the fd
-		 * non-blocking, but this function should only be called
-		 * upon the timeout, so lets continue anyway. */
-		fprintf(stderr, "timerfd read error: %m\n");
 
 	if (touchpad->fsm.events_count == 0) {
-		clock_gettime(CLOCK_MONOTONIC, &ts);
-		now = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
-
 		push_fsm_event(touchpad, FSM_EVENT_TIMEOUT);
 		process_fsm_events(touchpad, now);
 	}
 }
 
+/* Keep track of the velocity of two-finger scrolling, smoothed over the
+ * last two scroll events. */
+static void
+kinetic_track_scroll(struct touchpad_dispatch *touchpad,
+		     li_fixed_t dx, li_fixed_t dy, uint32_t time)
+{
+	uint32_t interval = time - touchpad->kinetic.time;
+
+	if (interval > 0 && interval <= TOUCHPAD_HISTORY_MAX_GAP) {
+		touchpad->kinetic.vx = (touchpad->kinetic.vx +
+					li_fixed_to_double(dx) / interval) / 2;
+		touchpad->kinetic.vy = (touchpad->kinetic.vy +
+					li_fixed_to_double(dy) / interval) / 2;
+	} else if (interval > TOUCHPAD_HISTORY_MAX_GAP) {
+		touchpad->kinetic.vx = 0.0;
+		touchpad->kinetic.vy = 0.0;
+	}
+
+	touchpad->kinetic.time = time;
+}
+
+static void
+kinetic_stop(struct touchpad_dispatch *touchpad)
+{
+	touchpad->kinetic.vx = 0.0;
+	touchpad->kinetic.vy = 0.0;
+	libinput_timer_cancel(&touchpad->kinetic.timer);
+}
+
+/* Continue scrolling after the fingers were lifted, if they were still
+ * scrolling when they were lifted. */
+static void
+kinetic_start(struct touchpad_dispatch *touchpad, uint32_t time)
+{
+	uint32_t interval = touchpad->device->kinetic_scroll.interval;
+
+	if (interval == 0 ||
+	    time - touchpad->kinetic.time > TOUCHPAD_KINETIC_LIFT_GRACE ||
+	    hypot(touchpad->kinetic.vx, touchpad->kinetic.vy) <
+	    TOUCHPAD_KINETIC_MIN_SPEED) {
+		kinetic_stop(touchpad);
+		return;
+	}
+
+	touchpad->kinetic.last = libinput_now();
+	libinput_timer_set(&touchpad->kinetic.timer,
+			   touchpad->kinetic.last + interval);
+}
+
+static void
+kinetic_timeout(uint64_t now, void *data)
+{
+	struct touchpad_dispatch *touchpad = data;
+	uint32_t interval = touchpad->device->kinetic_scroll.interval;
+	double elapsed = now - touchpad->kinetic.last;
+	double decay, distance;
+	li_fixed_t dx, dy;
+
+	if (interval == 0) {
+		kinetic_stop(touchpad);
+		return;
+	}
+
+	/* The distance covered while slowing down since the last event. */
+	decay = exp(-elapsed / TOUCHPAD_KINETIC_TIME_CONSTANT);
+	distance = TOUCHPAD_KINETIC_TIME_CONSTANT * (1.0 - decay);
+	dx = li_fixed_from_double(touchpad->kinetic.vx * distance);
+	dy = li_fixed_from_double(touchpad->kinetic.vy * distance);
+	touchpad->kinetic.vx *= decay;
+	touchpad->kinetic.vy *= decay;
+	touchpad->kinetic.last = now;
+
+	if (dx != 0 || dy != 0)
+		pointer_notify_scroll(&touchpad->device->base,
+				      now,
+				      LIBINPUT_POINTER_SCROLL_SOURCE_KINETIC,
+				      dx,
+				      dy);
+
+	if (hypot(touchpad->kinetic.vx, touchpad->kinetic.vy) <
+	    TOUCHPAD_KINETIC_MIN_SPEED)
+		kinetic_stop(touchpad);
+	else
+		libinput_timer_set(&touchpad->kinetic.timer, now + interval);
+}
+
+/* Derive motion, scroll and tap events from the state recorded by the
+ * event handlers. Called once per frame, at SYN_REPORT. */
 static void
 touchpad_update_state(struct touchpad_dispatch *touchpad, uint32_t time)
 {
-	int motion_index;
-	int center_x, center_y;
-	double dx = 0.0, dy = 0.0;
+	struct touchpad_touch *touch;
+	li_fixed_t dx = 0, dy = 0;
 	struct libinput_device *base = &touchpad->device->base;
+	int i, updated = 0;
 
+	/* Touchpads without slots report the position of a different
+	 * finger, or of the middle of the fingers, when the number of
+	 * fingers changes, so the motion history is restarted. */
 	if (touchpad->reset ||
-	    touchpad->last_finger_state != touchpad->finger_state) {
+	    (!touchpad->has_mt &&
+	     touchpad->last_finger_state != touchpad->finger_state)) {
 		touchpad->reset = 0;
-		touchpad->motion_count = 0;
-		touchpad->event_mask = TOUCHPAD_EVENT_NONE;
-		touchpad->event_mask_filter =
-			TOUCHPAD_EVENT_ABSOLUTE_X | TOUCHPAD_EVENT_ABSOLUTE_Y;
+		touchpad_reset_remainders(touchpad);
+
+		/* Fingers lifted one after the other keep the velocity
+		 * until the last one is lifted. */
+		if (!(touchpad->state & TOUCHPAD_STATE_TOUCH))
+			kinetic_start(touchpad, time);
+		else if (touchpad->finger_state >=
+			 touchpad->last_finger_state)
+			kinetic_stop(touchpad);
+
+		for (i = 0; i < MAX_SLOTS; i++) {
+			touchpad->touches[i].history_count = 0;
+			touchpad->touches[i].dirty = 0;
+		}
 
 		touchpad->last_finger_state = touchpad->finger_state;
 
@@ -486,75 +748,54 @@ touchpad_update_state(struct touchpad_dispatch *touchpad, uint32_t time)
 
 		return;
 	}
+	if (touchpad->last_finger_state != touchpad->finger_state)
+		touchpad_reset_remainders(touchpad);
 	touchpad->last_finger_state = touchpad->finger_state;
 
-	if (!(touchpad->event_mask & TOUCHPAD_EVENT_REPORT))
-		return;
-	else
-		touchpad->event_mask &= ~TOUCHPAD_EVENT_REPORT;
+	for (i = 0; i < MAX_SLOTS; i++) {
+		touch = &touchpad->touches[i];
+		if (touch->tracking_id != -1 && touch->dirty)
+			updated = 1;
+		touch->dirty = 0;
+	}
 
-	if ((touchpad->event_mask & touchpad->event_mask_filter) !=
-	    touchpad->event_mask_filter)
+	if (!updated) {
+		process_fsm_events(touchpad, time);
 		return;
+	}
 
-	touchpad->event_mask_filter = TOUCHPAD_EVENT_ABSOLUTE_ANY;
-	touchpad->event_mask = 0;
-
-	/* Avoid noise by moving center only when delta reaches a threshold
-	 * distance from the old center. */
-	if (touchpad->motion_count > 0) {
-		center_x = hysteresis(touchpad->hw_abs.x,
-				      touchpad->hysteresis.center_x,
-				      touchpad->hysteresis.margin_x);
-		center_y = hysteresis(touchpad->hw_abs.y,
-				      touchpad->hysteresis.center_y,
-				      touchpad->hysteresis.margin_y);
-	} else {
-		center_x = touchpad->hw_abs.x;
-		center_y = touchpad->hw_abs.y;
+	/* Touches that didn't move this frame are pushed as well, so that
+	 * the centroid doesn't move with their past motion. */
+	for (i = 0; i < MAX_SLOTS; i++) {
+		touch = &touchpad->touches[i];
+		if (touch->tracking_id != -1)
+			touch_update_history(touchpad, touch, time);
 	}
-	touchpad->hysteresis.center_x = center_x;
-	touchpad->hysteresis.center_y = center_y;
-	touchpad->hw_abs.x = center_x;
-	touchpad->hw_abs.y = center_y;
-
-	/* Update motion history tracker */
-	motion_index = (touchpad->motion_index + 1) % TOUCHPAD_HISTORY_LENGTH;
-	touchpad->motion_index = motion_index;
-	touchpad->motion_history[motion_index].x = touchpad->hw_abs.x;
-	touchpad->motion_history[motion_index].y = touchpad->hw_abs.y;
-	if (touchpad->motion_count < 4)
-		touchpad->motion_count++;
-
-	if (touchpad->motion_count >= 4) {
-		touchpad_get_delta(touchpad, &dx, &dy);
 
+	if (touchpad_get_delta(touchpad, &dx, &dy) > 0) {
 		filter_motion(touchpad, &dx, &dy, time);
 
 		if (touchpad->finger_state == TOUCHPAD_FINGERS_ONE) {
-			pointer_notify_motion(
+			pointer_notify_motion(base, time, dx, dy);
+			if (time - touchpad->kinetic.time >
+			    TOUCHPAD_KINETIC_LIFT_GRACE) {
+				touchpad->kinetic.vx = 0.0;
+				touchpad->kinetic.vy = 0.0;
+			}
+		} else if (touchpad->finger_state == TOUCHPAD_FINGERS_TWO &&
+			   (dx != 0 || dy != 0)) {
+			pointer_notify_scroll(
 				base,
 				time,
-				li_fixed_from_double(dx),
-				li_fixed_from_double(dy));
-		} else if (touchpad->finger_state == TOUCHPAD_FINGERS_TWO) {
-			if (dx != 0.0)
-				pointer_notify_axis(
-					base,
-					time,
-					LIBINPUT_POINTER_AXIS_HORIZONTAL_SCROLL,
-					li_fixed_from_double(dx));
-			if (dy != 0.0)
-				pointer_notify_axis(
-					base,
-					time,
-					LIBINPUT_POINTER_AXIS_VERTICAL_SCROLL,
-					li_fixed_from_double(dy));
+				LIBINPUT_POINTER_SCROLL_SOURCE_FINGER,
+				dx,
+				dy);
+			kinetic_track_scroll(touchpad, dx, dy, time);
 		}
 	}
 
 	if (!(touchpad->state & TOUCHPAD_STATE_MOVE) &&
-	    ((int)dx || (int)dy)) {
+	    (li_fixed_to_int(dx) || li_fixed_to_int(dy))) {
 		touchpad->state |= TOUCHPAD_STATE_MOVE;
 		push_fsm_event(touchpad, FSM_EVENT_MOTION);
 	}
@@ -567,6 +808,11 @@ on_touch(struct touchpad_dispatch *touchpad)
 {
 	touchpad->state |= TOUCHPAD_STATE_TOUCH;
 
+	kinetic_stop(touchpad);
+
+	if (!touchpad->has_mt)
+		touch_begin(&touchpad->touches[0], 0);
+
 	push_fsm_event(touchpad, FSM_EVENT_TOUCH);
 }
 
@@ -577,6 +823,9 @@ on_release(struct touchpad_dispatch *touchpad)
 	touchpad->reset = 1;
 	touchpad->state &= ~(TOUCHPAD_STATE_MOVE | TOUCHPAD_STATE_TOUCH);
 
+	if (!touchpad->has_mt)
+		touchpad->touches[0].tracking_id = -1;
+
 	push_fsm_event(touchpad, FSM_EVENT_RELEASE);
 }
 
@@ -585,6 +834,8 @@ process_absolute(struct touchpad_dispatch *touchpad,
 		 struct evdev_device *device,
 		 struct input_event *e)
 {
+	struct touchpad_touch *touch;
+
 	switch (e->code) {
 	case ABS_PRESSURE:
 		if (e->value > touchpad->pressure.touch_high &&
@@ -596,17 +847,41 @@ process_absolute(struct touchpad_dispatch *touchpad,
 
 		break;
 	case ABS_X:
-		if (touchpad->state & TOUCHPAD_STATE_TOUCH) {
-			touchpad->hw_abs.x = e->value;
-			touchpad->event_mask |= TOUCHPAD_EVENT_ABSOLUTE_ANY;
-			touchpad->event_mask |= TOUCHPAD_EVENT_ABSOLUTE_X;
+		if (!touchpad->has_mt) {
+			touchpad->touches[0].x = e->value;
+			touchpad->touches[0].dirty = 1;
 		}
 		break;
 	case ABS_Y:
-		if (touchpad->state & TOUCHPAD_STATE_TOUCH) {
-			touchpad->hw_abs.y = e->value;
-			touchpad->event_mask |= TOUCHPAD_EVENT_ABSOLUTE_ANY;
-			touchpad->event_mask |= TOUCHPAD_EVENT_ABSOLUTE_Y;
+		if (!touchpad->has_mt) {
+			touchpad->touches[0].y = e->value;
+			touchpad->touches[0].dirty = 1;
+		}
+		break;
+	case ABS_MT_SLOT:
+		touchpad->slot = e->value;
+		break;
+	case ABS_MT_TRACKING_ID:
+		touch = touchpad_current_touch(touchpad);
+		if (!touch)
+			break;
+		if (e->value == -1)
+			touch->tracking_id = -1;
+		else
+			touch_begin(touch, e->value);
+		break;
+	case ABS_MT_POSITION_X:
+		touch = touchpad_current_touch(touchpad);
+		if (touch) {
+			touch->x = e->value;
+			touch->dirty = 1;
+		}
+		break;
+	case ABS_MT_POSITION_Y:
+		touch = touchpad_current_touch(touchpad);
+		if (touch) {
+			touch->y = e->value;
+			touch->dirty = 1;
 		}
 		break;
 	}
@@ -691,7 +966,7 @@ touchpad_process(struct evdev_dispatch *dispatch,
 	switch (e->type) {
 	case EV_SYN:
 		if (e->code == SYN_REPORT)
-			touchpad->event_mask |= TOUCHPAD_EVENT_REPORT;
+			touchpad_update_state(touchpad, time);
 		break;
 	case EV_ABS:
 		process_absolute(touchpad, device, e);
@@ -700,8 +975,19 @@ touchpad_process(struct evdev_dispatch *dispatch,
 		process_key(touchpad, device, e, time);
 		break;
 	}
+}
+
+static void
+touchpad_process_frame(struct evdev_dispatch *dispatch,
+		       struct evdev_device *device,
+		       struct input_event *events,
+		       int count,
+		       uint32_t time)
+{
+	int i;
 
-	touchpad_update_state(touchpad, time);
+	for (i = 0; i < count; i++)
+		touchpad_process(dispatch, device, &events[i], time);
 }
 
 static void
@@ -709,30 +995,58 @@ touchpad_destroy(struct evdev_dispatch *dispatch)
 {
 	struct touchpad_dispatch *touchpad =
 		(struct touchpad_dispatch *) dispatch;
-	struct libinput *libinput = touchpad->device->base.seat->libinput;
 
 	touchpad->filter->interface->destroy(touchpad->filter);
-	libinput_remove_source(libinput, touchpad->fsm.timer.source);
-	free(touchpad->fsm.events);
+	libinput_timer_cancel(&touchpad->fsm.timer);
+	libinput_timer_cancel(&touchpad->kinetic.timer);
 	free(dispatch);
 }
 
+static void
+touchpad_remove(struct evdev_dispatch *dispatch)
+{
+	struct touchpad_dispatch *touchpad =
+		(struct touchpad_dispatch *) dispatch;
+
+	libinput_timer_cancel(&touchpad->fsm.timer);
+	kinetic_stop(touchpad);
+}
+
+static const uint16_t touchpad_abs_codes[] = {
+	ABS_X,
+	ABS_Y,
+	ABS_PRESSURE,
+	ABS_MT_SLOT,
+	ABS_MT_POSITION_X,
+	ABS_MT_POSITION_Y,
+	ABS_MT_TRACKING_ID,
+};
+
+static const struct evdev_event_mask touchpad_event_masks[] = {
+	EVDEV_EVENT_MASK(EV_ABS, touchpad_abs_codes),
+	EVDEV_EVENT_MASK_NONE(EV_REL),
+	EVDEV_EVENT_MASK_NONE(EV_MSC),
+	EVDEV_EVENT_MASK_NONE(EV_SW),
+	EVDEV_EVENT_MASK_NONE(EV_LED),
+	EVDEV_EVENT_MASK_END
+};
+
 struct evdev_dispatch_interface touchpad_interface = {
 	touchpad_process,
-	touchpad_destroy
+	touchpad_destroy,
+	touchpad_event_masks,
+	touchpad_process_frame,
+	touchpad_remove
 };
 
 static int
 touchpad_init(struct touchpad_dispatch *touchpad,
 	      struct evdev_device *device)
 {
+	const struct touchpad_quirks *quirks;
 	struct motion_filter *accel;
-
-	unsigned long prop_bits[INPUT_PROP_MAX];
-	struct input_absinfo absinfo;
-	unsigned long abs_bits[NBITS(ABS_MAX)];
-
-	bool has_buttonpad;
+	int32_t res_x, res_y;
+	int i;
 
 	double width;
 	double height;
@@ -742,37 +1056,53 @@ touchpad_init(struct touchpad_dispatch *touchpad,
 	touchpad->device = device;
 
 	/* Detect model */
-	touchpad->model = get_touchpad_model(device);
-
-	ioctl(device->fd, EVIOCGPROP(sizeof(prop_bits)), prop_bits);
-	has_buttonpad = TEST_BIT(prop_bits, INPUT_PROP_BUTTONPAD);
+	quirks = touchpad_quirks_lookup(device->base.seat->libinput,
+					device->caps.id.vendor,
+					device->caps.id.product,
+					device->devname);
+	touchpad->model = quirks->model;
 
 	/* Configure pressure */
-	ioctl(device->fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits);
-	if (TEST_BIT(abs_bits, ABS_PRESSURE)) {
-		ioctl(device->fd, EVIOCGABS(ABS_PRESSURE), &absinfo);
+	if (device->caps.has_pressure)
 		configure_touchpad_pressure(touchpad,
-					    absinfo.minimum,
-					    absinfo.maximum);
-	}
+					    quirks,
+					    device->caps.pressure_min,
+					    device->caps.pressure_max);
 
 	/* Configure acceleration factor */
-	width = abs(device->abs.max_x - device->abs.min_x);
-	height = abs(device->abs.max_y - device->abs.min_y);
-	diagonal = sqrt(width*width + height*height);
+	res_x = quirks->resolution_x ? quirks->resolution_x :
+				       device->caps.res_x;
+	res_y = quirks->resolution_y ? quirks->resolution_y :
+				       device->caps.res_y;
+	if (res_x > 0 && res_y > 0) {
+		touchpad->scale.x = TOUCHPAD_NORMALIZED_RESOLUTION / res_x;
+		touchpad->scale.y = TOUCHPAD_NORMALIZED_RESOLUTION / res_y;
+		diagonal = TOUCHPAD_NORMALIZED_RESOLUTION *
+			TOUCHPAD_NORMALIZED_DIAGONAL;
+	} else {
+		touchpad->scale.x = 1.0;
+		touchpad->scale.y = 1.0;
+		width = abs(device->abs.max_x - device->abs.min_x);
+		height = abs(device->abs.max_y - device->abs.min_y);
+		diagonal = sqrt(width*width + height*height);
+	}
 
-	/* Set default parameters */
+	/* Set model parameters */
 	touchpad->constant_accel_factor =
-		DEFAULT_CONSTANT_ACCEL_NUMERATOR / diagonal;
-	touchpad->min_accel_factor = DEFAULT_MIN_ACCEL_FACTOR;
-	touchpad->max_accel_factor = DEFAULT_MAX_ACCEL_FACTOR;
+		quirks->constant_accel_numerator / diagonal;
+	touchpad->min_accel_factor = quirks->min_accel_factor;
+	touchpad->max_accel_factor = quirks->max_accel_factor;
 
+	/* Hysteresis is applied in device units. */
 	touchpad->hysteresis.margin_x =
-		diagonal / DEFAULT_HYSTERESIS_MARGIN_DENOMINATOR;
+		diagonal / quirks->hysteresis_margin_denominator /
+		touchpad->scale.x;
 	touchpad->hysteresis.margin_y =
-		diagonal / DEFAULT_HYSTERESIS_MARGIN_DENOMINATOR;
-	touchpad->hysteresis.center_x = 0;
-	touchpad->hysteresis.center_y = 0;
+		diagonal / quirks->hysteresis_margin_denominator /
+		touchpad->scale.y;
+
+	touchpad->history_length = quirks->history_length;
+	touchpad_reset_remainders(touchpad);
 
 	/* Configure acceleration profile */
 	accel = create_pointer_accelator_filter(touchpad_profile);
@@ -783,34 +1113,36 @@ touchpad_init(struct touchpad_dispatch *touchpad,
 	/* Setup initial state */
 	touchpad->reset = 1;
 
-	memset(touchpad->motion_history, 0, sizeof touchpad->motion_history);
-	touchpad->motion_index = 0;
-	touchpad->motion_count = 0;
+	memset(touchpad->touches, 0, sizeof touchpad->touches);
+	for (i = 0; i < MAX_SLOTS; i++)
+		touchpad->touches[i].tracking_id = -1;
+	touchpad->has_mt = device->is_mt;
+	touchpad->slot = touchpad->has_mt ? device->mt.slot : 0;
 
 	touchpad->state = TOUCHPAD_STATE_NONE;
 	touchpad->last_finger_state = 0;
 	touchpad->finger_state = 0;
 
-	touchpad->fsm.events = NULL;
 	touchpad->fsm.events_count = 0;
-	touchpad->fsm.events_len = 0;
+	touchpad->fsm.overflow = false;
 	touchpad->fsm.state = FSM_IDLE;
 
-	touchpad->fsm.timer.fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
-	touchpad->fsm.timer.source =
-		libinput_add_fd(touchpad->device->base.seat->libinput,
-				touchpad->fsm.timer.fd,
-				fsm_timeout_handler,
-				touchpad);
+	libinput_timer_init(&touchpad->fsm.timer,
+			    touchpad->device->base.seat->libinput,
+			    fsm_timeout_handler,
+			    touchpad);
 
-	if (touchpad->fsm.timer.source == NULL) {
-		close(touchpad->fsm.timer.fd);
-		accel->interface->destroy(accel);
-		return -1;
-	}
+	touchpad->kinetic.vx = 0.0;
+	touchpad->kinetic.vy = 0.0;
+	touchpad->kinetic.time = 0;
+	touchpad->kinetic.last = 0;
+	libinput_timer_init(&touchpad->kinetic.timer,
+			    touchpad->device->base.seat->libinput,
+			    kinetic_timeout,
+			    touchpad);
 
 	/* Configure */
-	touchpad->fsm.enable = !has_buttonpad;
+	touchpad->fsm.enable = !device->caps.has_buttonpad;
 
 	return 0;
 }
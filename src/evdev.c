@@ -29,8 +29,10 @@
 #include <linux/input.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <mtdev.h>
+#include <pthread.h>
 #include <assert.h>
+#include <time.h>
+#include <libudev.h>
 
 #include "libinput.h"
 #include "evdev.h"
@@ -38,34 +40,117 @@
 
 #define DEFAULT_AXIS_STEP_DISTANCE li_fixed_from_int(10)
 
+#ifndef EVIOCSCLOCKID
+#define EVIOCSCLOCKID _IOW('E', 0xa0, int)
+#endif
+
+#ifndef EVIOCSMASK
+struct input_mask {
+	__u32 type;
+	__u32 codes_size;
+	__u64 codes_ptr;
+};
+
+#define EVIOCSMASK _IOW('E', 0x93, struct input_mask)
+#endif
+
+static const struct {
+	enum libinput_led weston;
+	int evdev;
+} led_map[] = {
+	{ LIBINPUT_LED_NUM_LOCK, LED_NUML },
+	{ LIBINPUT_LED_CAPS_LOCK, LED_CAPSL },
+	{ LIBINPUT_LED_SCROLL_LOCK, LED_SCROLLL },
+};
+
+/* The LED codes of led_map, which dispatchers of devices that may be
+ * keyboards let through so that the tracked LED state follows changes
+ * made by other clients of the device or the VT. */
+static const uint16_t evdev_led_codes[] = {
+	LED_NUML,
+	LED_CAPSL,
+	LED_SCROLLL,
+};
+
+/* Replace the tracked LED state with the kernel's, when the device is
+ * added or after events were dropped. */
+static void
+evdev_device_sync_leds(struct evdev_device *device)
+{
+	unsigned long led_bits[NBITS(LED_CNT)];
+	unsigned int i;
+
+	memset(led_bits, 0, sizeof led_bits);
+	if (ioctl(device->fd, EVIOCGLED(sizeof led_bits), led_bits) < 0) {
+		device->leds.known = 0;
+		return;
+	}
+
+	device->leds.state = 0;
+	for (i = 0; i < ARRAY_LENGTH(led_map); i++) {
+		if (TEST_BIT(led_bits, led_map[i].evdev))
+			device->leds.state |= led_map[i].weston;
+	}
+	device->leds.known = 1;
+}
+
+/* The kernel passes LED changes on to every client of the device,
+ * including the ones libinput writes itself. */
+static inline void
+evdev_update_led_state(struct evdev_device *device, struct input_event *e)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_LENGTH(led_map); i++) {
+		if (led_map[i].evdev != e->code)
+			continue;
+
+		if (e->value)
+			device->leds.state |= led_map[i].weston;
+		else
+			device->leds.state &= ~led_map[i].weston;
+		break;
+	}
+}
+
 void
 evdev_device_led_update(struct evdev_device *device, enum libinput_led leds)
 {
-	static const struct {
-		enum libinput_led weston;
-		int evdev;
-	} map[] = {
-		{ LIBINPUT_LED_NUM_LOCK, LED_NUML },
-		{ LIBINPUT_LED_CAPS_LOCK, LED_CAPSL },
-		{ LIBINPUT_LED_SCROLL_LOCK, LED_SCROLLL },
-	};
-	struct input_event ev[ARRAY_LENGTH(map) + 1];
-	unsigned int i;
+	struct input_event ev[ARRAY_LENGTH(led_map) + 1];
+	enum libinput_led changed;
+	unsigned int i, count = 0;
 
 	if (!(device->seat_caps & EVDEV_DEVICE_KEYBOARD))
 		return;
 
+	/* Only write the LEDs that differ from the tracked state. If that
+	 * isn't known, write all of them. */
+	if (device->leds.known)
+		changed = device->leds.state ^ leds;
+	else
+		changed = ~0;
+	if (!changed)
+		return;
+
 	memset(ev, 0, sizeof(ev));
-	for (i = 0; i < ARRAY_LENGTH(map); i++) {
-		ev[i].type = EV_LED;
-		ev[i].code = map[i].evdev;
-		ev[i].value = !!(leds & map[i].weston);
+	for (i = 0; i < ARRAY_LENGTH(led_map); i++) {
+		if (!(changed & led_map[i].weston))
+			continue;
+
+		ev[count].type = EV_LED;
+		ev[count].code = led_map[i].evdev;
+		ev[count].value = !!(leds & led_map[i].weston);
+		count++;
 	}
-	ev[i].type = EV_SYN;
-	ev[i].code = SYN_REPORT;
+	ev[count].type = EV_SYN;
+	ev[count].code = SYN_REPORT;
+	count++;
 
-	i = write(device->fd, ev, sizeof ev);
+	i = write(device->fd, ev, count * sizeof ev[0]);
 	(void)i; /* no, we really don't care about the return value */
+
+	device->leds.state = leds;
+	device->leds.known = 1;
 }
 
 static void
@@ -86,6 +171,28 @@ transform_absolute(struct evdev_device *device, int32_t *x, int32_t *y)
 	}
 }
 
+static inline void
+evdev_notify_relative_motion(struct evdev_device *device, uint32_t time)
+{
+	struct libinput_device *base = &device->base;
+
+	if (!device->motion_rate.interval ||
+	    !pointer_merge_motion(base,
+				  time,
+				  device->rel.dx,
+				  device->rel.dy))
+		pointer_notify_motion(base,
+				      time,
+				      device->rel.dx,
+				      device->rel.dy);
+	if (device->motion_rate.interval) {
+		libinput_timer_cancel(&device->motion_rate.timer);
+		device->motion_rate.last = libinput_now();
+	}
+	device->rel.dx = 0;
+	device->rel.dy = 0;
+}
+
 static void
 evdev_flush_pending_event(struct evdev_device *device, uint32_t time)
 {
@@ -99,12 +206,7 @@ evdev_flush_pending_event(struct evdev_device *device, uint32_t time)
 	case EVDEV_NONE:
 		return;
 	case EVDEV_RELATIVE_MOTION:
-		pointer_notify_motion(base,
-				      time,
-				      device->rel.dx,
-				      device->rel.dy);
-		device->rel.dx = 0;
-		device->rel.dy = 0;
+		evdev_notify_relative_motion(device, time);
 		break;
 	case EVDEV_ABSOLUTE_MT_DOWN:
 		if (!(device->seat_caps & EVDEV_DEVICE_TOUCH))
@@ -182,6 +284,38 @@ evdev_flush_pending_event(struct evdev_device *device, uint32_t time)
 	device->pending_event = EVDEV_NONE;
 }
 
+static void
+evdev_motion_rate_timeout(uint64_t now, void *data)
+{
+	struct evdev_device *device = data;
+
+	if (device->pending_event == EVDEV_RELATIVE_MOTION)
+		evdev_flush_pending_event(device, device->motion_rate.time);
+}
+
+/* Hold back relative motion at the end of a frame if the previous motion
+ * was reported less than the rate limit interval ago. The motion keeps
+ * accumulating and is flushed by the next event of the device or by the
+ * timer, whichever comes first. */
+static int
+evdev_hold_relative_motion(struct evdev_device *device, uint32_t time)
+{
+	uint64_t next;
+
+	if (!device->motion_rate.interval ||
+	    device->pending_event != EVDEV_RELATIVE_MOTION)
+		return 0;
+
+	next = device->motion_rate.last + device->motion_rate.interval;
+	if (libinput_now() >= next)
+		return 0;
+
+	device->motion_rate.time = time;
+	libinput_timer_set(&device->motion_rate.timer, next);
+
+	return 1;
+}
+
 static void
 evdev_process_touch_button(struct evdev_device *device, int time, int value)
 {
@@ -194,47 +328,128 @@ evdev_process_touch_button(struct evdev_device *device, int time, int value)
 				 EVDEV_ABSOLUTE_TOUCH_UP);
 }
 
-static inline void
-evdev_process_key(struct evdev_device *device, struct input_event *e, int time)
+static void
+evdev_repeat_timeout(uint64_t now, void *data)
 {
-	/* ignore kernel key repeat */
-	if (e->value == 2)
-		return;
+	struct evdev_device *device = data;
+	uint32_t key = device->repeat.key;
 
-	if (e->code == BTN_TOUCH) {
-		if (!device->is_mt)
-			evdev_process_touch_button(device, time, e->value);
+	/* The key may have been released while events were dropped. */
+	if (!TEST_BIT(device->key_mask, key))
 		return;
+
+	keyboard_notify_key_repeat(&device->base, device->repeat.next, key);
+
+	/* Repeats are scheduled relative to the previous one rather than
+	 * to when the timer was handled, so that they don't drift. */
+	device->repeat.next += device->repeat.interval;
+	if (device->repeat.next <= now)
+		device->repeat.next = now + device->repeat.interval;
+
+	libinput_timer_set(&device->repeat.timer, device->repeat.next);
+}
+
+enum evdev_key_type {
+	EVDEV_KEY_TYPE_KEY,
+	EVDEV_KEY_TYPE_BUTTON,
+	EVDEV_KEY_TYPE_OTHER_BUTTON,
+	EVDEV_KEY_TYPE_TOUCH,
+};
+
+/* Codes outside these ranges are keyboard keys. Other buttons, e.g.
+ * those of joysticks and tablet tools, are reported as keys but don't
+ * repeat. */
+static const struct {
+	uint16_t first, last; /* inclusive */
+	enum evdev_key_type type;
+} evdev_key_type_ranges[] = {
+	{ BTN_MISC, BTN_9, EVDEV_KEY_TYPE_OTHER_BUTTON },
+	{ BTN_LEFT, BTN_TASK, EVDEV_KEY_TYPE_BUTTON },
+	{ BTN_JOYSTICK, BTN_THUMBR, EVDEV_KEY_TYPE_OTHER_BUTTON },
+	{ BTN_DIGI, BTN_TOUCH - 1, EVDEV_KEY_TYPE_OTHER_BUTTON },
+	{ BTN_TOUCH, BTN_TOUCH, EVDEV_KEY_TYPE_TOUCH },
+	{ BTN_STYLUS, BTN_GEAR_UP, EVDEV_KEY_TYPE_OTHER_BUTTON },
+	{ BTN_TRIGGER_HAPPY1, BTN_TRIGGER_HAPPY40,
+	  EVDEV_KEY_TYPE_OTHER_BUTTON },
+};
+
+/* The type of every key code, expanded from the ranges above once per
+ * process so that it is looked up with a single load. */
+static uint8_t evdev_key_types[KEY_CNT];
+static pthread_once_t evdev_key_types_once = PTHREAD_ONCE_INIT;
+
+static void
+evdev_key_types_init(void)
+{
+	unsigned int i, code;
+
+	for (i = 0; i < ARRAY_LENGTH(evdev_key_type_ranges); i++) {
+		for (code = evdev_key_type_ranges[i].first;
+		     code <= evdev_key_type_ranges[i].last;
+		     code++)
+			evdev_key_types[code] = evdev_key_type_ranges[i].type;
 	}
+}
 
-	evdev_flush_pending_event(device, time);
+static void
+evdev_repeat_key(struct evdev_device *device, uint32_t key, int pressed)
+{
+	if (!device->repeat.delay)
+		return;
 
-	switch (e->code) {
-	case BTN_LEFT:
-	case BTN_RIGHT:
-	case BTN_MIDDLE:
-	case BTN_SIDE:
-	case BTN_EXTRA:
-	case BTN_FORWARD:
-	case BTN_BACK:
-	case BTN_TASK:
+	if (evdev_key_types[key] != EVDEV_KEY_TYPE_KEY)
+		return;
+
+	if (pressed) {
+		device->repeat.key = key;
+		device->repeat.next = libinput_now() + device->repeat.delay;
+		libinput_timer_set(&device->repeat.timer,
+				   device->repeat.next);
+	} else if (key == device->repeat.key) {
+		libinput_timer_cancel(&device->repeat.timer);
+	}
+}
+
+/* Report a key or button event. Any pending event must have been flushed
+ * before. */
+static inline void
+evdev_notify_key(struct evdev_device *device, struct input_event *e,
+		 uint32_t time)
+{
+	if (evdev_key_types[e->code] == EVDEV_KEY_TYPE_BUTTON) {
 		pointer_notify_button(
 			&device->base,
 			time,
 			e->code,
 			e->value ? LIBINPUT_POINTER_BUTTON_STATE_PRESSED :
 				   LIBINPUT_POINTER_BUTTON_STATE_RELEASED);
-		break;
+		return;
+	}
 
-	default:
-		keyboard_notify_key(
-			&device->base,
-			time,
-			e->code,
-			e->value ? LIBINPUT_KEYBOARD_KEY_STATE_PRESSED :
-				   LIBINPUT_KEYBOARD_KEY_STATE_RELEASED);
-		break;
+	keyboard_notify_key(
+		&device->base,
+		time,
+		e->code,
+		e->value ? LIBINPUT_KEYBOARD_KEY_STATE_PRESSED :
+			   LIBINPUT_KEYBOARD_KEY_STATE_RELEASED);
+	evdev_repeat_key(device, e->code, e->value);
+}
+
+static inline void
+evdev_process_key(struct evdev_device *device, struct input_event *e, int time)
+{
+	/* ignore kernel key repeat */
+	if (e->value == 2)
+		return;
+
+	if (evdev_key_types[e->code] == EVDEV_KEY_TYPE_TOUCH) {
+		if (!device->is_mt)
+			evdev_process_touch_button(device, time, e->value);
+		return;
 	}
+
+	evdev_flush_pending_event(device, time);
+	evdev_notify_key(device, e, time);
 }
 
 static void
@@ -415,6 +630,8 @@ fallback_process(struct evdev_dispatch *dispatch,
 		evdev_process_key(device, event, time);
 		break;
 	case EV_SYN:
+		if (evdev_hold_relative_motion(device, time))
+			break;
 		need_frame = evdev_need_touch_frame(device);
 		evdev_flush_pending_event(device, time);
 		if (need_frame)
@@ -429,37 +646,506 @@ fallback_destroy(struct evdev_dispatch *dispatch)
 	free(dispatch);
 }
 
+static const uint16_t fallback_abs_codes[] = {
+	ABS_X,
+	ABS_Y,
+	ABS_MT_SLOT,
+	ABS_MT_POSITION_X,
+	ABS_MT_POSITION_Y,
+	ABS_MT_TRACKING_ID,
+};
+
+static const uint16_t fallback_rel_codes[] = {
+	REL_X,
+	REL_Y,
+	REL_HWHEEL,
+	REL_WHEEL,
+};
+
+static const struct evdev_event_mask fallback_event_masks[] = {
+	EVDEV_EVENT_MASK(EV_ABS, fallback_abs_codes),
+	EVDEV_EVENT_MASK(EV_REL, fallback_rel_codes),
+	EVDEV_EVENT_MASK_NONE(EV_MSC),
+	EVDEV_EVENT_MASK_NONE(EV_SW),
+	EVDEV_EVENT_MASK(EV_LED, evdev_led_codes),
+	EVDEV_EVENT_MASK_END
+};
+
 struct evdev_dispatch_interface fallback_interface = {
 	fallback_process,
-	fallback_destroy
+	fallback_destroy,
+	fallback_event_masks,
+	NULL,
+	NULL
+};
+
+/* The dispatchers below are specializations of the fallback dispatcher
+ * for devices of a single class, with the branches that can't apply to
+ * the class left out. */
+
+static void
+keyboard_process(struct evdev_dispatch *dispatch,
+		 struct evdev_device *device,
+		 struct input_event *event,
+		 uint32_t time)
+{
+	/* Keyboards never have pending events, so keys are reported as
+	 * they come in. Kernel key repeats are ignored. */
+	if (event->type == EV_KEY && event->value != 2)
+		evdev_notify_key(device, event, time);
+}
+
+static const struct evdev_event_mask keyboard_event_masks[] = {
+	EVDEV_EVENT_MASK_NONE(EV_MSC),
+	EVDEV_EVENT_MASK_NONE(EV_SW),
+	EVDEV_EVENT_MASK(EV_LED, evdev_led_codes),
+	EVDEV_EVENT_MASK_END
+};
+
+static void
+keyboard_process_frame(struct evdev_dispatch *dispatch,
+		       struct evdev_device *device,
+		       struct input_event *events,
+		       int count,
+		       uint32_t time)
+{
+	struct input_event *e, *end = events + count;
+
+	for (e = events; e < end; e++) {
+		if (e->type == EV_KEY && e->value != 2)
+			evdev_notify_key(device, e, time);
+	}
+}
+
+struct evdev_dispatch_interface keyboard_interface = {
+	keyboard_process,
+	fallback_destroy,
+	keyboard_event_masks,
+	keyboard_process_frame,
+	NULL
+};
+
+static inline void
+evdev_flush_relative_motion(struct evdev_device *device, uint32_t time)
+{
+	if (device->pending_event != EVDEV_RELATIVE_MOTION)
+		return;
+
+	evdev_notify_relative_motion(device, time);
+	device->pending_event = EVDEV_NONE;
+}
+
+static inline void
+mouse_process(struct evdev_dispatch *dispatch,
+	      struct evdev_device *device,
+	      struct input_event *event,
+	      uint32_t time)
+{
+	switch (event->type) {
+	case EV_REL:
+		evdev_process_relative(device, event, time);
+		break;
+	case EV_KEY:
+		if (event->value == 2)
+			break;
+		evdev_flush_relative_motion(device, time);
+		evdev_notify_key(device, event, time);
+		break;
+	case EV_SYN:
+		if (!evdev_hold_relative_motion(device, time))
+			evdev_flush_relative_motion(device, time);
+		break;
+	}
+}
+
+static const struct evdev_event_mask mouse_event_masks[] = {
+	EVDEV_EVENT_MASK(EV_REL, fallback_rel_codes),
+	EVDEV_EVENT_MASK_NONE(EV_MSC),
+	EVDEV_EVENT_MASK_NONE(EV_SW),
+	EVDEV_EVENT_MASK(EV_LED, evdev_led_codes),
+	EVDEV_EVENT_MASK_END
+};
+
+static void
+mouse_process_frame(struct evdev_dispatch *dispatch,
+		    struct evdev_device *device,
+		    struct input_event *events,
+		    int count,
+		    uint32_t time)
+{
+	struct input_event *e, *end = events + count;
+
+	for (e = events; e < end; e++)
+		mouse_process(dispatch, device, e, time);
+}
+
+struct evdev_dispatch_interface mouse_interface = {
+	mouse_process,
+	fallback_destroy,
+	mouse_event_masks,
+	mouse_process_frame,
+	NULL
+};
+
+static inline void
+evdev_flush_touch_frame(struct evdev_device *device, uint32_t time)
+{
+	if (device->pending_event == EVDEV_NONE)
+		return;
+
+	evdev_flush_pending_event(device, time);
+	touch_notify_frame(&device->base, time);
+}
+
+static void
+touchscreen_process(struct evdev_dispatch *dispatch,
+		    struct evdev_device *device,
+		    struct input_event *event,
+		    uint32_t time)
+{
+	switch (event->type) {
+	case EV_ABS:
+		evdev_process_absolute_motion(device, event);
+		break;
+	case EV_KEY:
+		evdev_process_key(device, event, time);
+		break;
+	case EV_SYN:
+		evdev_flush_touch_frame(device, time);
+		break;
+	}
+}
+
+static const uint16_t touchscreen_abs_codes[] = {
+	ABS_X,
+	ABS_Y,
+};
+
+static const struct evdev_event_mask touchscreen_event_masks[] = {
+	EVDEV_EVENT_MASK(EV_ABS, touchscreen_abs_codes),
+	EVDEV_EVENT_MASK_NONE(EV_MSC),
+	EVDEV_EVENT_MASK_NONE(EV_SW),
+	EVDEV_EVENT_MASK_NONE(EV_LED),
+	EVDEV_EVENT_MASK_END
+};
+
+struct evdev_dispatch_interface touchscreen_interface = {
+	touchscreen_process,
+	fallback_destroy,
+	touchscreen_event_masks,
+	NULL,
+	NULL
+};
+
+static void
+touchscreen_mt_process(struct evdev_dispatch *dispatch,
+		       struct evdev_device *device,
+		       struct input_event *event,
+		       uint32_t time)
+{
+	switch (event->type) {
+	case EV_ABS:
+		evdev_process_touch(device, event, time);
+		break;
+	case EV_KEY:
+		if (event->value == 2 ||
+		    evdev_key_types[event->code] == EVDEV_KEY_TYPE_TOUCH)
+			break;
+		evdev_flush_pending_event(device, time);
+		evdev_notify_key(device, event, time);
+		break;
+	case EV_SYN:
+		evdev_flush_touch_frame(device, time);
+		break;
+	}
+}
+
+static const uint16_t touchscreen_mt_abs_codes[] = {
+	ABS_MT_SLOT,
+	ABS_MT_POSITION_X,
+	ABS_MT_POSITION_Y,
+	ABS_MT_TRACKING_ID,
+};
+
+static const struct evdev_event_mask touchscreen_mt_event_masks[] = {
+	EVDEV_EVENT_MASK(EV_ABS, touchscreen_mt_abs_codes),
+	EVDEV_EVENT_MASK_NONE(EV_MSC),
+	EVDEV_EVENT_MASK_NONE(EV_SW),
+	EVDEV_EVENT_MASK_NONE(EV_LED),
+	EVDEV_EVENT_MASK_END
+};
+
+struct evdev_dispatch_interface touchscreen_mt_interface = {
+	touchscreen_mt_process,
+	fallback_destroy,
+	touchscreen_mt_event_masks,
+	NULL,
+	NULL
 };
 
 static struct evdev_dispatch *
-fallback_dispatch_create(void)
+fallback_dispatch_create(enum evdev_device_class device_class)
 {
 	struct evdev_dispatch *dispatch = malloc(sizeof *dispatch);
 	if (dispatch == NULL)
 		return NULL;
 
-	dispatch->interface = &fallback_interface;
+	switch (device_class) {
+	case EVDEV_CLASS_KEYBOARD:
+		dispatch->interface = &keyboard_interface;
+		break;
+	case EVDEV_CLASS_MOUSE:
+		dispatch->interface = &mouse_interface;
+		break;
+	case EVDEV_CLASS_TOUCHSCREEN:
+		dispatch->interface = &touchscreen_interface;
+		break;
+	case EVDEV_CLASS_TOUCHSCREEN_MT:
+		dispatch->interface = &touchscreen_mt_interface;
+		break;
+	default:
+		dispatch->interface = &fallback_interface;
+		break;
+	}
 
 	return dispatch;
 }
 
+/* Have the kernel drop the events the dispatcher doesn't consume, so they
+ * are never read. Kernels without EVIOCSMASK keep sending everything. */
+static void
+evdev_device_apply_event_masks(struct evdev_device *device,
+			       const struct evdev_event_mask *masks)
+{
+	unsigned long codes[NBITS(KEY_CNT)];
+	struct input_mask mask;
+	unsigned int i;
+
+	if (!masks)
+		return;
+
+	for (; masks->type != EV_MAX; masks++) {
+		memset(codes, 0, sizeof codes);
+		for (i = 0; i < masks->ncodes; i++)
+			codes[LONG(masks->codes[i])] |= BIT(masks->codes[i]);
+
+		mask.type = masks->type;
+		mask.codes_size = sizeof codes;
+		mask.codes_ptr = (uintptr_t) codes;
+		if (ioctl(device->fd, EVIOCSMASK, &mask) < 0 &&
+		    (errno == ENOTTY || errno == EINVAL))
+			return;
+	}
+}
+
+int
+evdev_device_is_touchpad(struct evdev_device *device)
+{
+	/* The udev classification takes hwdb fixups into account, so it
+	 * is preferred over our own heuristics. It is only trusted as far
+	 * as the device has the axes the touchpad dispatcher needs. Without
+	 * a classification, the evdev bits decide. */
+	if (device->udev_tags & EVDEV_UDEV_TAGS_CLASS)
+		return (device->udev_tags & EVDEV_UDEV_TAG_TOUCHPAD) &&
+		       device->abs.max_x > device->abs.min_x &&
+		       device->abs.max_y > device->abs.min_y;
+
+	return device->caps.is_touchpad;
+}
+
+int
+evdev_device_init_dispatch(struct evdev_device *device)
+{
+	if (evdev_device_is_touchpad(device))
+		device->dispatch = evdev_touchpad_create(device);
+
+	/* If the dispatch was not set up use the fallback. */
+	if (device->dispatch == NULL)
+		device->dispatch =
+			fallback_dispatch_create(device->caps.device_class);
+
+	if (device->dispatch == NULL)
+		return -1;
+
+	evdev_device_apply_event_masks(device,
+				       device->dispatch->interface->event_masks);
+
+	return 0;
+}
+
+static void
+evdev_device_set_key_state(struct evdev_device *device,
+			   const unsigned long *key_mask)
+{
+	struct libinput_seat *seat = device->base.seat;
+	unsigned long changed;
+	unsigned int i, code;
+
+	for (i = 0; i < ARRAY_LENGTH(device->key_mask); i++) {
+		changed = device->key_mask[i] ^ key_mask[i];
+		if (!changed)
+			continue;
+
+		for (code = i * BITS_PER_LONG;
+		     changed && code < KEY_CNT;
+		     code++, changed >>= 1) {
+			if (!(changed & 1))
+				continue;
+			if (TEST_BIT(key_mask, code))
+				seat->key_count[code]++;
+			else
+				seat->key_count[code]--;
+		}
+
+		device->key_mask[i] = key_mask[i];
+	}
+}
+
+/* Replace the tracked key state with the kernel's, e.g. after events were
+ * dropped. */
 static void
+evdev_device_sync_key_state(struct evdev_device *device)
+{
+	unsigned long key_mask[NBITS(KEY_CNT)];
+
+	memset(key_mask, 0, sizeof key_mask);
+	if (ioctl(device->fd, EVIOCGKEY(sizeof key_mask), key_mask) < 0)
+		return;
+
+	evdev_device_set_key_state(device, key_mask);
+}
+
+/* Replace the tracked key and LED state after events were dropped. */
+static void
+evdev_device_resync(struct evdev_device *device)
+{
+	evdev_device_sync_key_state(device);
+	if (device->seat_caps & EVDEV_DEVICE_KEYBOARD)
+		evdev_device_sync_leds(device);
+}
+
+static inline void
+evdev_update_key_state(struct evdev_device *device, struct input_event *e)
+{
+	struct libinput_seat *seat = device->base.seat;
+
+	/* ignore kernel key repeat */
+	if (e->value == 2 || e->code >= KEY_CNT)
+		return;
+
+	if (!!e->value == TEST_BIT(device->key_mask, e->code))
+		return;
+
+	if (e->value) {
+		device->key_mask[LONG(e->code)] |= BIT(e->code);
+		seat->key_count[e->code]++;
+	} else {
+		device->key_mask[LONG(e->code)] &= ~BIT(e->code);
+		seat->key_count[e->code]--;
+	}
+}
+
+static inline uint32_t
+evdev_event_time(const struct input_event *e)
+{
+	return e->time.tv_sec * 1000 + e->time.tv_usec / 1000;
+}
+
+static void
+evdev_process_frames(struct evdev_device *device,
+		     struct input_event *ev, int count)
+{
+	struct evdev_dispatch *dispatch = device->dispatch;
+	struct input_event *e, *end, *frame;
+
+	frame = ev;
+	end = ev + count;
+	for (e = ev; e < end; e++) {
+		if (e->type == EV_KEY)
+			evdev_update_key_state(device, e);
+		else if (e->type == EV_LED)
+			evdev_update_led_state(device, e);
+		else if (e->type == EV_SYN && e->code == SYN_DROPPED)
+			evdev_device_resync(device);
+
+		if (e->type == EV_SYN && e->code == SYN_REPORT) {
+			dispatch->interface->process_frame(dispatch, device,
+							   frame, e + 1 - frame,
+							   evdev_event_time(e));
+			frame = e + 1;
+		}
+	}
+
+	if (frame < end)
+		dispatch->interface->process_frame(dispatch, device,
+						   frame, end - frame,
+						   evdev_event_time(frame));
+}
+
+void
 evdev_process_events(struct evdev_device *device,
 		     struct input_event *ev, int count)
 {
 	struct evdev_dispatch *dispatch = device->dispatch;
-	struct input_event *e, *end;
+	struct input_event *e, *end, *converted;
+	struct timeval last = { 0, 0 };
 	uint32_t time = 0;
+	int i, n;
+
+	if (dispatch->interface->process_frame && !device->mt_a) {
+		evdev_process_frames(device, ev, count);
+		return;
+	}
 
 	e = ev;
 	end = e + count;
 	for (e = ev; e < end; e++) {
-		time = e->time.tv_sec * 1000 + e->time.tv_usec / 1000;
+		/* All events of a frame carry the same timestamp, so it only
+		 * needs converting when it changes. */
+		if (e->time.tv_usec != last.tv_usec ||
+		    e->time.tv_sec != last.tv_sec) {
+			last = e->time;
+			time = evdev_event_time(e);
+		}
+
+		if (e->type == EV_KEY)
+			evdev_update_key_state(device, e);
+		else if (e->type == EV_LED)
+			evdev_update_led_state(device, e);
+		else if (e->type == EV_SYN && e->code == SYN_DROPPED)
+			evdev_device_resync(device);
 
-		dispatch->interface->process(dispatch, device, e, time);
+		if (!device->mt_a) {
+			dispatch->interface->process(dispatch, device, e, time);
+			continue;
+		}
+
+		n = evdev_mt_a_convert(device->mt_a, e, &converted);
+		for (i = 0; i < n; i++)
+			dispatch->interface->process(dispatch, device,
+						     &converted[i], time);
+	}
+}
+
+/* Move timestamps of CLOCK_REALTIME to CLOCK_MONOTONIC, by the offset
+ * between the two clocks at the time the events are read. */
+static void
+evdev_convert_realtime(struct input_event *ev, int count)
+{
+	struct timespec monotonic, realtime;
+	int64_t offset, usec;
+	int i;
+
+	clock_gettime(CLOCK_REALTIME, &realtime);
+	clock_gettime(CLOCK_MONOTONIC, &monotonic);
+	offset = (int64_t) (realtime.tv_sec - monotonic.tv_sec) * 1000000 +
+		 (realtime.tv_nsec - monotonic.tv_nsec) / 1000;
+
+	for (i = 0; i < count; i++) {
+		usec = (int64_t) ev[i].time.tv_sec * 1000000 +
+		       ev[i].time.tv_usec - offset;
+		ev[i].time.tv_sec = usec / 1000000;
+		ev[i].time.tv_usec = usec % 1000000;
 	}
 }
 
@@ -472,16 +1158,20 @@ evdev_device_dispatch(void *data)
 	struct input_event ev[32];
 	int len;
 
+	/* The dispatcher is only set up once the device sends its first
+	 * events, so that devices that are never used don't allocate
+	 * filters or timers. */
+	if (!device->dispatch && evdev_device_init_dispatch(device) != 0) {
+		libinput_remove_source(libinput, device->source);
+		device->source = NULL;
+		return;
+	}
+
 	/* If the compositor is repainting, this function is called only once
 	 * per frame and we have to process all the events available on the
 	 * fd, otherwise there will be input lag. */
 	do {
-		if (device->mtdev)
-			len = mtdev_get(device->mtdev, fd, ev,
-					ARRAY_LENGTH(ev)) *
-				sizeof (struct input_event);
-		else
-			len = read(fd, &ev, sizeof ev);
+		len = read(fd, &ev, sizeof ev);
 
 		if (len < 0 || len % sizeof ev[0] != 0) {
 			if (len < 0 && errno != EAGAIN && errno != EINTR) {
@@ -493,22 +1183,109 @@ evdev_device_dispatch(void *data)
 			return;
 		}
 
+		if (device->realtime_clock)
+			evdev_convert_realtime(ev, len / sizeof ev[0]);
+
 		evdev_process_events(device, ev, len / sizeof ev[0]);
 
 	} while (len > 0);
 }
 
+void
+evdev_device_read_bits(int fd, struct evdev_device_bits *bits)
+{
+	memset(bits, 0, sizeof *bits);
+
+	ioctl(fd, EVIOCGID, &bits->id);
+	strcpy(bits->name, "unknown");
+	ioctl(fd, EVIOCGNAME(sizeof(bits->name)), bits->name);
+	bits->name[sizeof(bits->name) - 1] = '\0';
+
+	ioctl(fd, EVIOCGBIT(0, sizeof(bits->ev)), bits->ev);
+	if (TEST_BIT(bits->ev, EV_ABS))
+		ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(bits->abs)), bits->abs);
+	if (TEST_BIT(bits->ev, EV_REL))
+		ioctl(fd, EVIOCGBIT(EV_REL, sizeof(bits->rel)), bits->rel);
+	if (TEST_BIT(bits->ev, EV_KEY))
+		ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(bits->key)), bits->key);
+	ioctl(fd, EVIOCGPROP(sizeof(bits->prop)), bits->prop);
+}
+
+/* Test whether any bit in [first, last) is set, one word at a time. */
 static int
-evdev_configure_device(struct evdev_device *device)
+evdev_bits_any_set(const unsigned long *bits,
+		   unsigned int first, unsigned int last)
+{
+	unsigned long mask;
+	unsigned int i;
+
+	for (i = LONG(first); i <= LONG(last - 1); i++) {
+		mask = ~0UL;
+		if (i == LONG(first))
+			mask &= ~0UL << OFF(first);
+		if (i == LONG(last - 1))
+			mask &= ~0UL >> (BITS_PER_LONG - 1 - OFF(last - 1));
+		if (bits[i] & mask)
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Read the ranges of the axes the device has. */
+static void
+evdev_device_read_abs(int fd,
+		      const struct evdev_device_bits *bits,
+		      struct evdev_device_caps *caps)
 {
 	struct input_absinfo absinfo;
-	unsigned long ev_bits[NBITS(EV_MAX)];
-	unsigned long abs_bits[NBITS(ABS_MAX)];
-	unsigned long rel_bits[NBITS(REL_MAX)];
-	unsigned long key_bits[NBITS(KEY_MAX)];
+
+	if (!TEST_BIT(bits->ev, EV_ABS))
+		return;
+
+	if (TEST_BIT(bits->abs, ABS_X)) {
+		ioctl(fd, EVIOCGABS(ABS_X), &absinfo);
+		caps->min_x = absinfo.minimum;
+		caps->max_x = absinfo.maximum;
+		caps->res_x = absinfo.resolution;
+	}
+	if (TEST_BIT(bits->abs, ABS_Y)) {
+		ioctl(fd, EVIOCGABS(ABS_Y), &absinfo);
+		caps->min_y = absinfo.minimum;
+		caps->max_y = absinfo.maximum;
+		caps->res_y = absinfo.resolution;
+	}
+	if (TEST_BIT(bits->abs, ABS_MT_POSITION_X) &&
+	    TEST_BIT(bits->abs, ABS_MT_POSITION_Y)) {
+		ioctl(fd, EVIOCGABS(ABS_MT_POSITION_X), &absinfo);
+		caps->min_x = absinfo.minimum;
+		caps->max_x = absinfo.maximum;
+		caps->res_x = absinfo.resolution;
+		ioctl(fd, EVIOCGABS(ABS_MT_POSITION_Y), &absinfo);
+		caps->min_y = absinfo.minimum;
+		caps->max_y = absinfo.maximum;
+		caps->res_y = absinfo.resolution;
+	}
+	if (TEST_BIT(bits->abs, ABS_PRESSURE)) {
+		ioctl(fd, EVIOCGABS(ABS_PRESSURE), &absinfo);
+		caps->pressure_min = absinfo.minimum;
+		caps->pressure_max = absinfo.maximum;
+	}
+}
+
+/* Derive the capabilities of a device from its bitmaps, read once by
+ * evdev_device_read_bits(). */
+static void
+evdev_device_probe_caps(int fd,
+			const struct evdev_device_bits *bits,
+			struct evdev_device_caps *caps)
+{
 	int has_abs, has_rel, has_mt;
 	int has_button, has_keyboard, has_touch;
-	unsigned int i;
+
+	memset(caps, 0, sizeof *caps);
+	caps->id = bits->id;
+	evdev_device_read_abs(fd, bits, caps);
 
 	has_rel = 0;
 	has_abs = 0;
@@ -517,92 +1294,92 @@ evdev_configure_device(struct evdev_device *device)
 	has_keyboard = 0;
 	has_touch = 0;
 
-	ioctl(device->fd, EVIOCGBIT(0, sizeof(ev_bits)), ev_bits);
-	if (TEST_BIT(ev_bits, EV_ABS)) {
-		ioctl(device->fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)),
-		      abs_bits);
-
-		if (TEST_BIT(abs_bits, ABS_X)) {
-			ioctl(device->fd, EVIOCGABS(ABS_X), &absinfo);
-			device->abs.min_x = absinfo.minimum;
-			device->abs.max_x = absinfo.maximum;
-			has_abs = 1;
-		}
-		if (TEST_BIT(abs_bits, ABS_Y)) {
-			ioctl(device->fd, EVIOCGABS(ABS_Y), &absinfo);
-			device->abs.min_y = absinfo.minimum;
-			device->abs.max_y = absinfo.maximum;
+	if (TEST_BIT(bits->ev, EV_ABS)) {
+		if (TEST_BIT(bits->abs, ABS_X) || TEST_BIT(bits->abs, ABS_Y))
 			has_abs = 1;
-		}
-                /* We only handle the slotted Protocol B in weston.
-                   Devices with ABS_MT_POSITION_* but not ABS_MT_SLOT
-                   require mtdev for conversion. */
-		if (TEST_BIT(abs_bits, ABS_MT_POSITION_X) &&
-		    TEST_BIT(abs_bits, ABS_MT_POSITION_Y)) {
-			ioctl(device->fd, EVIOCGABS(ABS_MT_POSITION_X),
-			      &absinfo);
-			device->abs.min_x = absinfo.minimum;
-			device->abs.max_x = absinfo.maximum;
-			ioctl(device->fd, EVIOCGABS(ABS_MT_POSITION_Y),
-			      &absinfo);
-			device->abs.min_y = absinfo.minimum;
-			device->abs.max_y = absinfo.maximum;
-			device->is_mt = 1;
+		/* We only handle the slotted Protocol B. Devices with
+		 * ABS_MT_POSITION_* but not ABS_MT_SLOT are converted
+		 * from Protocol A. */
+		if (TEST_BIT(bits->abs, ABS_MT_POSITION_X) &&
+		    TEST_BIT(bits->abs, ABS_MT_POSITION_Y)) {
+			caps->is_mt = 1;
+			caps->has_mt_slot = TEST_BIT(bits->abs, ABS_MT_SLOT);
 			has_touch = 1;
 			has_mt = 1;
-
-			if (!TEST_BIT(abs_bits, ABS_MT_SLOT)) {
-				device->mtdev = mtdev_new_open(device->fd);
-				if (!device->mtdev)
-					return 0;
-				device->mt.slot = device->mtdev->caps.slot.value;
-			} else {
-				ioctl(device->fd, EVIOCGABS(ABS_MT_SLOT),
-				      &absinfo);
-				device->mt.slot = absinfo.value;
-			}
 		}
+		caps->has_pressure = TEST_BIT(bits->abs, ABS_PRESSURE);
 	}
-	if (TEST_BIT(ev_bits, EV_REL)) {
-		ioctl(device->fd, EVIOCGBIT(EV_REL, sizeof(rel_bits)),
-		      rel_bits);
-		if (TEST_BIT(rel_bits, REL_X) || TEST_BIT(rel_bits, REL_Y))
+	if (TEST_BIT(bits->ev, EV_REL)) {
+		if (TEST_BIT(bits->rel, REL_X) || TEST_BIT(bits->rel, REL_Y))
 			has_rel = 1;
 	}
-	if (TEST_BIT(ev_bits, EV_KEY)) {
-		ioctl(device->fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)),
-		      key_bits);
-		if (TEST_BIT(key_bits, BTN_TOOL_FINGER) &&
-		    !TEST_BIT(key_bits, BTN_TOOL_PEN) &&
-		    (has_abs || has_mt)) {
-			device->dispatch = evdev_touchpad_create(device);
-		}
-		for (i = KEY_ESC; i < KEY_MAX; i++) {
-			if (i >= BTN_MISC && i < KEY_OK)
-				continue;
-			if (TEST_BIT(key_bits, i)) {
-				has_keyboard = 1;
-				break;
-			}
-		}
-		if (TEST_BIT(key_bits, BTN_TOUCH))
+	if (TEST_BIT(bits->ev, EV_KEY)) {
+		if (TEST_BIT(bits->key, BTN_TOOL_FINGER) &&
+		    !TEST_BIT(bits->key, BTN_TOOL_PEN) &&
+		    (has_abs || has_mt))
+			caps->is_touchpad = 1;
+		if (evdev_bits_any_set(bits->key, KEY_ESC, BTN_MISC) ||
+		    evdev_bits_any_set(bits->key, KEY_OK, KEY_MAX))
+			has_keyboard = 1;
+		if (TEST_BIT(bits->key, BTN_TOUCH))
 			has_touch = 1;
-		for (i = BTN_MISC; i < BTN_JOYSTICK; i++) {
-			if (TEST_BIT(key_bits, i)) {
-				has_button = 1;
-				break;
-			}
-		}
+		if (evdev_bits_any_set(bits->key, BTN_MISC, BTN_JOYSTICK))
+			has_button = 1;
 	}
-	if (TEST_BIT(ev_bits, EV_LED))
+	if (TEST_BIT(bits->ev, EV_LED))
 		has_keyboard = 1;
 
+	caps->has_buttonpad = TEST_BIT(bits->prop, INPUT_PROP_BUTTONPAD);
+
 	if ((has_abs || has_rel) && has_button)
-		device->seat_caps |= EVDEV_DEVICE_POINTER;
+		caps->seat_caps |= EVDEV_DEVICE_POINTER;
 	if (has_keyboard)
-		device->seat_caps |= EVDEV_DEVICE_KEYBOARD;
+		caps->seat_caps |= EVDEV_DEVICE_KEYBOARD;
 	if (has_touch && !has_button)
-		device->seat_caps |= EVDEV_DEVICE_TOUCH;
+		caps->seat_caps |= EVDEV_DEVICE_TOUCH;
+
+	caps->device_class = EVDEV_CLASS_GENERIC;
+	if (caps->seat_caps == EVDEV_DEVICE_KEYBOARD) {
+		if (!TEST_BIT(bits->ev, EV_REL) && !TEST_BIT(bits->ev, EV_ABS))
+			caps->device_class = EVDEV_CLASS_KEYBOARD;
+	} else if (caps->seat_caps & EVDEV_DEVICE_POINTER) {
+		if (has_rel && !TEST_BIT(bits->ev, EV_ABS))
+			caps->device_class = EVDEV_CLASS_MOUSE;
+	} else if (caps->seat_caps == EVDEV_DEVICE_TOUCH) {
+		if (!TEST_BIT(bits->ev, EV_REL))
+			caps->device_class = has_mt ?
+				EVDEV_CLASS_TOUCHSCREEN_MT :
+				EVDEV_CLASS_TOUCHSCREEN;
+	}
+}
+
+static int
+evdev_configure_device(struct evdev_device *device,
+		       const struct evdev_device_bits *bits)
+{
+	struct evdev_device_caps *caps = &device->caps;
+	struct input_absinfo absinfo;
+
+	evdev_device_probe_caps(device->fd, bits, caps);
+
+	device->abs.min_x = caps->min_x;
+	device->abs.max_x = caps->max_x;
+	device->abs.min_y = caps->min_y;
+	device->abs.max_y = caps->max_y;
+	device->is_mt = caps->is_mt;
+	device->seat_caps = caps->seat_caps;
+
+	if (caps->is_mt) {
+		if (!caps->has_mt_slot) {
+			device->mt_a = evdev_mt_a_create();
+			if (!device->mt_a)
+				return -1;
+			device->mt.slot = 0;
+		} else {
+			ioctl(device->fd, EVIOCGABS(ABS_MT_SLOT), &absinfo);
+			device->mt.slot = absinfo.value;
+		}
+	}
 
 	return 0;
 }
@@ -611,11 +1388,16 @@ struct evdev_device *
 evdev_device_create(struct libinput_seat *seat,
 		    const char *devnode,
 		    const char *sysname,
-		    int fd)
+		    int fd,
+		    const struct evdev_device_bits *bits,
+		    enum evdev_device_udev_tags udev_tags)
 {
 	struct libinput *libinput = seat->libinput;
 	struct evdev_device *device;
-	char devname[256] = "unknown";
+	struct evdev_device_bits read_bits;
+	int clockid = CLOCK_MONOTONIC;
+
+	pthread_once(&evdev_key_types_once, evdev_key_types_init);
 
 	device = zalloc(sizeof *device);
 	if (device == NULL)
@@ -625,7 +1407,7 @@ evdev_device_create(struct libinput_seat *seat,
 
 	device->seat_caps = 0;
 	device->is_mt = 0;
-	device->mtdev = NULL;
+	device->mt_a = NULL;
 	device->devnode = strdup(devnode);
 	device->sysname = strdup(sysname);
 	device->mt.slot = -1;
@@ -634,31 +1416,52 @@ evdev_device_create(struct libinput_seat *seat,
 	device->dispatch = NULL;
 	device->fd = fd;
 	device->pending_event = EVDEV_NONE;
+	device->udev_tags = udev_tags;
+	libinput_timer_init(&device->repeat.timer, libinput,
+			    evdev_repeat_timeout, device);
+	libinput_timer_init(&device->motion_rate.timer, libinput,
+			    evdev_motion_rate_timeout, device);
+
+	/* Have the kernel timestamp events in the clock domain of our own
+	 * timers rather than with the wall clock, which may jump. Kernels
+	 * that can't do so timestamp with the wall clock, which is then
+	 * converted as the events are read. */
+	if (ioctl(fd, EVIOCSCLOCKID, &clockid) < 0) {
+		log_info("failed to set the clock of '%s' to "
+			 "CLOCK_MONOTONIC, converting its timestamps.\n",
+			 devnode);
+		device->realtime_clock = 1;
+	}
 
-	ioctl(device->fd, EVIOCGNAME(sizeof(devname)), devname);
-	devname[sizeof(devname) - 1] = '\0';
-	device->devname = strdup(devname);
+	if (!bits) {
+		evdev_device_read_bits(fd, &read_bits);
+		bits = &read_bits;
+	}
+	device->devname = strdup(bits->name);
 
 	libinput_seat_ref(seat);
 
-	if (evdev_configure_device(device) == -1)
+	if (evdev_configure_device(device, bits) == -1)
 		goto err;
 
 	if (device->seat_caps == 0) {
 		goto err;
 	}
 
-	/* If the dispatch was not set up use the fallback. */
-	if (device->dispatch == NULL)
-		device->dispatch = fallback_dispatch_create();
-	if (device->dispatch == NULL)
-		goto err;
-
 	device->source =
 		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
 	if (!device->source)
 		goto err;
 
+	evdev_device_sync_key_state(device);
+	if (device->seat_caps & EVDEV_DEVICE_KEYBOARD)
+		evdev_device_sync_leds(device);
+
+	/* Keyboards joining a seat whose LEDs are managed through
+	 * libinput_seat_led_update() pick up the seat state. */
+	if (seat->leds_set)
+		evdev_device_led_update(device, seat->leds);
+
 	list_insert(seat->devices_list.prev, &device->base.link);
 	notify_added_device(&device->base);
 
@@ -669,11 +1472,126 @@ err:
 	return NULL;
 }
 
+int
+evdev_device_set_repeat(struct evdev_device *device,
+			uint32_t delay,
+			uint32_t interval)
+{
+	if (!(device->seat_caps & EVDEV_DEVICE_KEYBOARD))
+		return -1;
+
+	if (delay && !interval)
+		return -1;
+
+	libinput_timer_cancel(&device->repeat.timer);
+	device->repeat.delay = delay;
+	device->repeat.interval = interval;
+
+	return 0;
+}
+
+int
+evdev_device_set_max_motion_rate(struct evdev_device *device, uint32_t rate)
+{
+	if (!(device->seat_caps & EVDEV_DEVICE_POINTER))
+		return -1;
+
+	if (device->pending_event == EVDEV_RELATIVE_MOTION)
+		evdev_flush_pending_event(device, device->motion_rate.time);
+
+	libinput_timer_cancel(&device->motion_rate.timer);
+	device->motion_rate.interval = 0;
+	if (rate)
+		device->motion_rate.interval = rate < 1000 ? 1000 / rate : 1;
+
+	return 0;
+}
+
+int
+evdev_device_set_tap(struct evdev_device *device,
+		     enum libinput_touchpad_tap_mode mode,
+		     uint32_t timeout)
+{
+	if (!evdev_device_is_touchpad(device))
+		return -1;
+
+	device->tap.mode = mode;
+	device->tap.timeout = timeout;
+
+	return 0;
+}
+
+int
+evdev_device_set_kinetic_scroll(struct evdev_device *device, uint32_t rate)
+{
+	if (!evdev_device_is_touchpad(device))
+		return -1;
+
+	device->kinetic_scroll.interval = 0;
+	if (rate)
+		device->kinetic_scroll.interval =
+			rate < 1000 ? 1000 / rate : 1;
+
+	return 0;
+}
+
+/* Devices udev classified as something libinput doesn't handle, e.g.
+ * joysticks, are not opened at all. Devices without a classification are
+ * probed. */
+int
+evdev_udev_tags_is_handled(enum evdev_device_udev_tags tags)
+{
+	if (!(tags & EVDEV_UDEV_TAGS_CLASS))
+		return 1;
+
+	return !!(tags & EVDEV_UDEV_TAGS_HANDLED);
+}
+
+enum evdev_device_udev_tags
+evdev_device_get_udev_tags(struct udev_device *udev_device)
+{
+	static const struct {
+		const char *property;
+		enum evdev_device_udev_tags tag;
+	} map[] = {
+		{ "ID_INPUT", EVDEV_UDEV_TAG_INPUT },
+		{ "ID_INPUT_KEY", EVDEV_UDEV_TAG_KEY },
+		{ "ID_INPUT_KEYBOARD", EVDEV_UDEV_TAG_KEYBOARD },
+		{ "ID_INPUT_MOUSE", EVDEV_UDEV_TAG_MOUSE },
+		{ "ID_INPUT_TOUCHPAD", EVDEV_UDEV_TAG_TOUCHPAD },
+		{ "ID_INPUT_TOUCHSCREEN", EVDEV_UDEV_TAG_TOUCHSCREEN },
+		{ "ID_INPUT_TABLET", EVDEV_UDEV_TAG_TABLET },
+		{ "ID_INPUT_JOYSTICK", EVDEV_UDEV_TAG_JOYSTICK },
+		{ "ID_INPUT_ACCELEROMETER", EVDEV_UDEV_TAG_ACCELEROMETER },
+	};
+	enum evdev_device_udev_tags tags = 0;
+	const char *value;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_LENGTH(map); i++) {
+		value = udev_device_get_property_value(udev_device,
+						       map[i].property);
+		if (value && strcmp(value, "0") != 0)
+			tags |= map[i].tag;
+	}
+
+	/* Without ID_INPUT, udev didn't classify the device and the other
+	 * properties mean nothing. */
+	if (!(tags & EVDEV_UDEV_TAG_INPUT))
+		return 0;
+
+	return tags;
+}
+
 int
 evdev_device_get_keys(struct evdev_device *device, char *keys, size_t size)
 {
 	memset(keys, 0, size);
-	return ioctl(device->fd, EVIOCGKEY(size), keys);
+	if (size > sizeof device->key_mask)
+		size = sizeof device->key_mask;
+	memcpy(keys, device->key_mask, size);
+
+	return size;
 }
 
 const char *
@@ -714,12 +1632,23 @@ evdev_device_has_capability(struct evdev_device *device,
 void
 evdev_device_remove(struct evdev_device *device)
 {
+	unsigned long key_mask[NBITS(KEY_CNT)];
+
+	/* Keys held on a removed device no longer count as pressed on the
+	 * seat. */
+	memset(key_mask, 0, sizeof key_mask);
+	evdev_device_set_key_state(device, key_mask);
+
+	libinput_timer_cancel(&device->repeat.timer);
+	libinput_timer_cancel(&device->motion_rate.timer);
+
+	if (device->dispatch && device->dispatch->interface->remove)
+		device->dispatch->interface->remove(device->dispatch);
+
 	if (device->source)
 		libinput_remove_source(device->base.seat->libinput,
 				       device->source);
 
-	if (device->mtdev)
-		mtdev_close_delete(device->mtdev);
 	close(device->fd);
 	list_remove(&device->base.link);
 
@@ -736,6 +1665,9 @@ evdev_device_destroy(struct evdev_device *device)
 	if (dispatch)
 		dispatch->interface->destroy(dispatch);
 
+	if (device->mt_a)
+		evdev_mt_a_destroy(device->mt_a);
+
 	libinput_seat_unref(device->base.seat);
 
 	free(device->devname);
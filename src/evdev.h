@@ -29,9 +29,20 @@
 #include <linux/input.h>
 
 #include "libinput-private.h"
+#include "timer.h"
 
 #define MAX_SLOTS 16
 
+/* copied from udev/extras/input_id/input_id.c */
+/* we must use this kernel-compatible implementation */
+#define BITS_PER_LONG (sizeof(unsigned long) * 8)
+#define NBITS(x) ((((x)-1)/BITS_PER_LONG)+1)
+#define OFF(x)  ((x)%BITS_PER_LONG)
+#define BIT(x)  (1UL<<OFF(x))
+#define LONG(x) ((x)/BITS_PER_LONG)
+#define TEST_BIT(array, bit)    ((array[LONG(bit)] >> OFF(bit)) & 1)
+/* end copied */
+
 enum evdev_event_type {
 	EVDEV_NONE,
 	EVDEV_ABSOLUTE_TOUCH_DOWN,
@@ -49,6 +60,58 @@ enum evdev_device_seat_capability {
 	EVDEV_DEVICE_TOUCH = (1 << 2)
 };
 
+/* Classification of a device by udev, from its ID_INPUT_* properties.
+ * EVDEV_UDEV_TAG_INPUT is set if udev processed the device. Nodes udev
+ * hasn't processed yet, or couldn't classify, have no class tags. */
+enum evdev_device_udev_tags {
+	EVDEV_UDEV_TAG_INPUT = (1 << 0),
+	EVDEV_UDEV_TAG_KEY = (1 << 1),
+	EVDEV_UDEV_TAG_KEYBOARD = (1 << 2),
+	EVDEV_UDEV_TAG_MOUSE = (1 << 3),
+	EVDEV_UDEV_TAG_TOUCHPAD = (1 << 4),
+	EVDEV_UDEV_TAG_TOUCHSCREEN = (1 << 5),
+	EVDEV_UDEV_TAG_TABLET = (1 << 6),
+	EVDEV_UDEV_TAG_JOYSTICK = (1 << 7),
+	EVDEV_UDEV_TAG_ACCELEROMETER = (1 << 8),
+};
+
+/* Tags of the devices libinput handles. */
+#define EVDEV_UDEV_TAGS_HANDLED (EVDEV_UDEV_TAG_KEY | \
+				 EVDEV_UDEV_TAG_KEYBOARD | \
+				 EVDEV_UDEV_TAG_MOUSE | \
+				 EVDEV_UDEV_TAG_TOUCHPAD | \
+				 EVDEV_UDEV_TAG_TOUCHSCREEN | \
+				 EVDEV_UDEV_TAG_TABLET)
+
+#define EVDEV_UDEV_TAGS_CLASS (EVDEV_UDEV_TAGS_HANDLED | \
+			       EVDEV_UDEV_TAG_JOYSTICK | \
+			       EVDEV_UDEV_TAG_ACCELEROMETER)
+
+/* Classes of devices with a dispatcher specialized for them. Devices that
+ * don't fall into exactly one class use the generic dispatcher. */
+enum evdev_device_class {
+	EVDEV_CLASS_GENERIC,
+	EVDEV_CLASS_KEYBOARD,
+	EVDEV_CLASS_MOUSE,
+	EVDEV_CLASS_TOUCHSCREEN,
+	EVDEV_CLASS_TOUCHSCREEN_MT,
+};
+
+/* Properties derived from the capabilities of an evdev device. */
+struct evdev_device_caps {
+	struct input_id id;
+	enum evdev_device_seat_capability seat_caps;
+	enum evdev_device_class device_class;
+	int min_x, max_x, min_y, max_y;
+	int res_x, res_y; /* units/mm, 0 if unknown */
+	int is_mt;
+	int has_mt_slot;
+	int is_touchpad;
+	int has_buttonpad;
+	int has_pressure;
+	int32_t pressure_min, pressure_max;
+};
+
 struct evdev_device {
 	struct libinput_device base;
 
@@ -74,32 +137,127 @@ struct evdev_device {
 			int32_t x, y;
 		} slots[MAX_SLOTS];
 	} mt;
-	struct mtdev *mtdev;
+	struct evdev_mt_a *mt_a;
 
 	struct {
 		li_fixed_t dx, dy;
 	} rel;
 
+	/* Keys currently held down, in the layout of EVIOCGKEY. */
+	unsigned long key_mask[NBITS(KEY_CNT)];
+
+	/* LEDs as last written by libinput or reported by the kernel. */
+	struct {
+		enum libinput_led state;
+		int known; /* 0 if the state couldn't be read */
+	} leds;
+
+	struct {
+		uint32_t delay, interval; /* ms, delay 0 disables repeat */
+		uint32_t key;
+		uint64_t next;
+		struct libinput_timer timer;
+	} repeat;
+
+	struct {
+		uint32_t interval; /* ms, 0 for no limit */
+		uint64_t last;
+		uint32_t time; /* time of the held back motion */
+		struct libinput_timer timer;
+	} motion_rate;
+
+	/* Tap settings, used by the touchpad dispatcher. */
+	struct {
+		enum libinput_touchpad_tap_mode mode;
+		uint32_t timeout; /* ms, 0 for the default */
+	} tap;
+
+	/* Kinetic scroll settings, used by the touchpad dispatcher. */
+	struct {
+		uint32_t interval; /* ms, 0 if disabled */
+	} kinetic_scroll;
+
 	enum evdev_event_type pending_event;
 	enum evdev_device_seat_capability seat_caps;
+	struct evdev_device_caps caps;
+	enum evdev_device_udev_tags udev_tags;
 
 	int is_mt;
+	int realtime_clock; /* the kernel timestamps with CLOCK_REALTIME */
 };
 
-/* copied from udev/extras/input_id/input_id.c */
-/* we must use this kernel-compatible implementation */
-#define BITS_PER_LONG (sizeof(unsigned long) * 8)
-#define NBITS(x) ((((x)-1)/BITS_PER_LONG)+1)
-#define OFF(x)  ((x)%BITS_PER_LONG)
-#define BIT(x)  (1UL<<OFF(x))
-#define LONG(x) ((x)/BITS_PER_LONG)
-#define TEST_BIT(array, bit)    ((array[LONG(bit)] >> OFF(bit)) & 1)
-/* end copied */
+struct evdev_device_bits {
+	struct input_id id;
+	char name[256];
+	unsigned long ev[NBITS(EV_MAX)];
+	unsigned long abs[NBITS(ABS_MAX)];
+	unsigned long rel[NBITS(REL_MAX)];
+	unsigned long key[NBITS(KEY_MAX)];
+	unsigned long prop[NBITS(INPUT_PROP_MAX)];
+};
 
 #define EVDEV_UNHANDLED_DEVICE ((struct evdev_device *) 1)
 
+/* A sample of the motion history of a touchpad touch, which is a ring
+ * of TOUCHPAD_HISTORY_MAX samples. */
+#define TOUCHPAD_HISTORY_MAX 16
+
+struct touchpad_motion {
+	int32_t x;
+	int32_t y;
+	uint32_t time;
+};
+
+/* The tap state machine of the touchpad dispatcher. */
+enum fsm_event {
+	FSM_EVENT_TOUCH,
+	FSM_EVENT_RELEASE,
+	FSM_EVENT_MOTION,
+	FSM_EVENT_TIMEOUT,
+	FSM_EVENT_COUNT
+};
+
+enum fsm_state {
+	FSM_IDLE,
+	FSM_TOUCH,
+	FSM_TAP,
+	FSM_TAP_PRESSED,
+	FSM_TAP_2,
+	FSM_DRAG,
+	FSM_STATE_COUNT
+};
+
+enum fsm_action {
+	FSM_ACTION_NONE = 0,
+	FSM_ACTION_PRESS,
+	FSM_ACTION_RELEASE,
+	FSM_ACTION_SET_TIMER
+};
+
+#define FSM_MAX_ACTIONS 3
+
+struct fsm_transition {
+	enum fsm_state next;
+	enum fsm_action actions[FSM_MAX_ACTIONS];
+};
+
 struct evdev_dispatch;
 
+/* The codes of one event type a dispatcher consumes. A mask without codes
+ * consumes no event of that type. Types without a mask are not
+ * restricted. */
+struct evdev_event_mask {
+	uint16_t type;
+	const uint16_t *codes;
+	unsigned int ncodes;
+};
+
+#define EVDEV_EVENT_MASK(type_, codes_) \
+	{ .type = (type_), .codes = (codes_), .ncodes = ARRAY_LENGTH(codes_) }
+#define EVDEV_EVENT_MASK_NONE(type_) \
+	{ .type = (type_), .codes = NULL, .ncodes = 0 }
+#define EVDEV_EVENT_MASK_END { .type = EV_MAX }
+
 struct evdev_dispatch_interface {
 	/* Process an evdev input event. */
 	void (*process)(struct evdev_dispatch *dispatch,
@@ -109,6 +267,26 @@ struct evdev_dispatch_interface {
 
 	/* Destroy an event dispatch handler and free all its resources. */
 	void (*destroy)(struct evdev_dispatch *dispatch);
+
+	/* Events consumed by the dispatcher, terminated by
+	 * EVDEV_EVENT_MASK_END. Other events are masked in the kernel. */
+	const struct evdev_event_mask *event_masks;
+
+	/* Process the events of a frame, up to and including its
+	 * SYN_REPORT, in one call. The events of a frame share one
+	 * timestamp. The last frame of a read may be incomplete, its
+	 * remaining events follow in the next call. Optional; events are
+	 * passed to process() one by one otherwise. */
+	void (*process_frame)(struct evdev_dispatch *dispatch,
+			      struct evdev_device *device,
+			      struct input_event *events,
+			      int count,
+			      uint32_t time);
+
+	/* Stop timers and anything else that could send events, as the
+	 * device is removed. The dispatcher is destroyed once the last
+	 * reference to the device is gone. Optional. */
+	void (*remove)(struct evdev_dispatch *dispatch);
 };
 
 struct evdev_dispatch {
@@ -119,17 +297,82 @@ struct evdev_device *
 evdev_device_create(struct libinput_seat *seat,
 		    const char *devnode,
 		    const char *sysname,
-		    int fd);
+		    int fd,
+		    const struct evdev_device_bits *bits,
+		    enum evdev_device_udev_tags udev_tags);
+
+struct udev_device;
+
+enum evdev_device_udev_tags
+evdev_device_get_udev_tags(struct udev_device *udev_device);
+
+int
+evdev_udev_tags_is_handled(enum evdev_device_udev_tags tags);
+
+int
+evdev_device_is_touchpad(struct evdev_device *device);
+
+void
+evdev_device_read_bits(int fd, struct evdev_device_bits *bits);
+
+/* Set up the dispatcher of the device, which is otherwise done when it
+ * sends its first events. */
+int
+evdev_device_init_dispatch(struct evdev_device *device);
+
+/* Process events read from the device. The dispatcher must be set up. */
+void
+evdev_process_events(struct evdev_device *device,
+		     struct input_event *ev, int count);
 
 struct evdev_dispatch *
 evdev_touchpad_create(struct evdev_device *device);
 
+void
+evdev_touchpad_estimate_delta(const struct touchpad_motion *history,
+			      unsigned int latest_index,
+			      unsigned int count,
+			      li_fixed_t *dx, li_fixed_t *dy);
+
+/* The transition of the tap state machine from state on event. */
+const struct fsm_transition *
+evdev_touchpad_fsm_transition(enum fsm_state state,
+			      enum fsm_event event,
+			      enum libinput_touchpad_tap_mode mode);
+
+struct evdev_mt_a *
+evdev_mt_a_create(void);
+
+void
+evdev_mt_a_destroy(struct evdev_mt_a *mt_a);
+
+int
+evdev_mt_a_convert(struct evdev_mt_a *mt_a,
+		   struct input_event *e,
+		   struct input_event **events);
+
 void
 evdev_device_proces_event(struct libinput_event *event);
 
 void
 evdev_device_led_update(struct evdev_device *device, enum libinput_led leds);
 
+int
+evdev_device_set_repeat(struct evdev_device *device,
+			uint32_t delay,
+			uint32_t interval);
+
+int
+evdev_device_set_max_motion_rate(struct evdev_device *device, uint32_t rate);
+
+int
+evdev_device_set_tap(struct evdev_device *device,
+		     enum libinput_touchpad_tap_mode mode,
+		     uint32_t timeout);
+
+int
+evdev_device_set_kinetic_scroll(struct evdev_device *device, uint32_t rate);
+
 int
 evdev_device_get_keys(struct evdev_device *device, char *keys, size_t size);
 
@@ -23,8 +23,11 @@
 #ifndef LIBINPUT_PRIVATE_H
 #define LIBINPUT_PRIVATE_H
 
+#include <linux/input.h>
+
 #include "libinput.h"
 #include "libinput-util.h"
+#include "touchpad-quirks.h"
 
 struct libinput_interface_backend {
 	int (*resume)(struct libinput *libinput);
@@ -32,18 +35,46 @@ struct libinput_interface_backend {
 	void (*destroy)(struct libinput *libinput);
 };
 
+/* Number of destroyed key events kept around for reuse. */
+#define LIBINPUT_KEY_EVENT_POOL_SIZE 32
+
 struct libinput {
 	int epoll_fd;
 	struct list source_destroy_list;
 
 	struct list seat_list;
 
+	/* Touchpad tuning read from the quirks file, hashed by vendor and
+	 * product. */
+	struct list touchpad_quirks[TOUCHPAD_QUIRKS_HASH_SIZE];
+
+	struct {
+		struct list list;
+		struct libinput_source *source;
+		int fd;
+	} timer;
+
+	struct libinput_event *key_event_pool[LIBINPUT_KEY_EVENT_POOL_SIZE];
+	size_t key_event_pool_count;
+
 	struct libinput_event **events;
 	size_t events_count;
 	size_t events_len;
 	size_t events_in;
 	size_t events_out;
 
+	size_t events_high_water_mark;
+	uint64_t events_posted;
+	uint64_t events_consumed;
+
+	struct {
+		size_t depth;
+		libinput_queue_threshold_func func;
+		void *user_data;
+	} queue_threshold;
+
+	int legacy_scroll_events;
+
 	const struct libinput_interface *interface;
 	const struct libinput_interface_backend *interface_backend;
 	void *user_data;
@@ -60,6 +91,13 @@ struct libinput_seat {
 	char *physical_name;
 	char *logical_name;
 	libinput_seat_destroy_func destroy;
+
+	/* Number of devices on the seat holding each key down. */
+	uint32_t key_count[KEY_CNT];
+
+	/* LED state set through libinput_seat_led_update(), if any. */
+	enum libinput_led leds;
+	int leds_set;
 };
 
 struct libinput_device {
@@ -120,12 +158,23 @@ keyboard_notify_key(struct libinput_device *device,
 		    uint32_t key,
 		    enum libinput_keyboard_key_state state);
 
+void
+keyboard_notify_key_repeat(struct libinput_device *device,
+			   uint32_t time,
+			   uint32_t key);
+
 void
 pointer_notify_motion(struct libinput_device *device,
 		      uint32_t time,
 		      li_fixed_t dx,
 		      li_fixed_t dy);
 
+int
+pointer_merge_motion(struct libinput_device *device,
+		     uint32_t time,
+		     li_fixed_t dx,
+		     li_fixed_t dy);
+
 void
 pointer_notify_motion_absolute(struct libinput_device *device,
 			       uint32_t time,
@@ -144,6 +193,13 @@ pointer_notify_axis(struct libinput_device *device,
 		    enum libinput_pointer_axis axis,
 		    li_fixed_t value);
 
+void
+pointer_notify_scroll(struct libinput_device *device,
+		      uint32_t time,
+		      enum libinput_pointer_scroll_source source,
+		      li_fixed_t dx,
+		      li_fixed_t dy);
+
 void
 touch_notify_touch(struct libinput_device *device,
 		   uint32_t time,
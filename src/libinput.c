@@ -33,6 +33,7 @@
 #include "libinput.h"
 #include "libinput-private.h"
 #include "evdev.h"
+#include "timer.h"
 
 struct libinput_source {
 	libinput_source_dispatch_t dispatch;
@@ -54,7 +55,9 @@ struct libinput_event_keyboard {
 	struct libinput_event base;
 	uint32_t time;
 	uint32_t key;
+	uint32_t seat_key_count;
 	enum libinput_keyboard_key_state state;
+	int repeat;
 };
 
 struct libinput_event_pointer {
@@ -66,6 +69,7 @@ struct libinput_event_pointer {
 	enum libinput_pointer_button_state state;
 	enum libinput_pointer_axis axis;
 	li_fixed_t value;
+	enum libinput_pointer_scroll_source source;
 };
 
 struct libinput_event_touch {
@@ -113,6 +117,7 @@ libinput_event_get_pointer_event(struct libinput_event *event)
 	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
 	case LIBINPUT_EVENT_POINTER_BUTTON:
 	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_SCROLL:
 		return (struct libinput_event_pointer *) event;
 	case LIBINPUT_EVENT_TOUCH_TOUCH:
 	case LIBINPUT_EVENT_TOUCH_FRAME:
@@ -137,6 +142,7 @@ libinput_event_get_keyboard_event(struct libinput_event *event)
 	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
 	case LIBINPUT_EVENT_POINTER_BUTTON:
 	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_SCROLL:
 	case LIBINPUT_EVENT_TOUCH_TOUCH:
 	case LIBINPUT_EVENT_TOUCH_FRAME:
 		break;
@@ -158,6 +164,7 @@ libinput_event_get_touch_event(struct libinput_event *event)
 	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
 	case LIBINPUT_EVENT_POINTER_BUTTON:
 	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_SCROLL:
 		break;
 	case LIBINPUT_EVENT_TOUCH_TOUCH:
 	case LIBINPUT_EVENT_TOUCH_FRAME:
@@ -181,6 +188,7 @@ libinput_event_get_device_notify_event(struct libinput_event *event)
 	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
 	case LIBINPUT_EVENT_POINTER_BUTTON:
 	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_SCROLL:
 	case LIBINPUT_EVENT_TOUCH_TOUCH:
 	case LIBINPUT_EVENT_TOUCH_FRAME:
 		break;
@@ -210,6 +218,20 @@ libinput_event_keyboard_get_key_state(
 	return event->state;
 }
 
+LIBINPUT_EXPORT uint32_t
+libinput_event_keyboard_get_seat_key_count(
+	struct libinput_event_keyboard *event)
+{
+	return event->seat_key_count;
+}
+
+LIBINPUT_EXPORT int
+libinput_event_keyboard_get_repeat(
+	struct libinput_event_keyboard *event)
+{
+	return event->repeat;
+}
+
 LIBINPUT_EXPORT uint32_t
 libinput_event_pointer_get_time(
 	struct libinput_event_pointer *event)
@@ -273,6 +295,31 @@ libinput_event_pointer_get_axis_value(
 	return event->value;
 }
 
+LIBINPUT_EXPORT li_fixed_t
+libinput_event_pointer_get_scroll_value(
+	struct libinput_event_pointer *event,
+	enum libinput_pointer_axis axis)
+{
+	if (event->base.type != LIBINPUT_EVENT_POINTER_SCROLL)
+		return 0;
+
+	switch (axis) {
+	case LIBINPUT_POINTER_AXIS_HORIZONTAL_SCROLL:
+		return event->x;
+	case LIBINPUT_POINTER_AXIS_VERTICAL_SCROLL:
+		return event->y;
+	}
+
+	return 0;
+}
+
+LIBINPUT_EXPORT enum libinput_pointer_scroll_source
+libinput_event_pointer_get_scroll_source(
+	struct libinput_event_pointer *event)
+{
+	return event->source;
+}
+
 LIBINPUT_EXPORT uint32_t
 libinput_event_touch_get_time(
 	struct libinput_event_touch *event)
@@ -371,6 +418,14 @@ libinput_init(struct libinput *libinput,
 	list_init(&libinput->source_destroy_list);
 	list_init(&libinput->seat_list);
 
+	if (libinput_timer_subsys_init(libinput) != 0) {
+		free(libinput->events);
+		close(libinput->epoll_fd);
+		return -1;
+	}
+
+	touchpad_quirks_init(libinput);
+
 	return 0;
 }
 
@@ -420,6 +475,14 @@ libinput_destroy(struct libinput *libinput)
 		libinput_seat_destroy(seat);
 	}
 
+	touchpad_quirks_destroy(libinput);
+
+	while (libinput->key_event_pool_count > 0)
+		free(libinput->key_event_pool[--libinput->key_event_pool_count]);
+
+	libinput_timer_subsys_destroy(libinput);
+	libinput_drop_destroyed_sources(libinput);
+
 	close(libinput->epoll_fd);
 	free(libinput);
 }
@@ -427,9 +490,27 @@ libinput_destroy(struct libinput *libinput)
 LIBINPUT_EXPORT void
 libinput_event_destroy(struct libinput_event *event)
 {
+	struct libinput *libinput;
+
 	if (event == NULL)
 		return;
 
+	/* Key events are recycled, as they are by far the most common ones
+	 * on most setups and all have the same size. */
+	if (event->type == LIBINPUT_EVENT_KEYBOARD_KEY) {
+		libinput = event->device->seat->libinput;
+		libinput_device_unref(event->device);
+		if (libinput->key_event_pool_count <
+		    LIBINPUT_KEY_EVENT_POOL_SIZE) {
+			libinput->key_event_pool[
+				libinput->key_event_pool_count++] = event;
+			return;
+		}
+
+		free(event);
+		return;
+	}
+
 	if (event->device)
 		libinput_device_unref(event->device);
 
@@ -502,6 +583,18 @@ libinput_seat_get_user_data(struct libinput_seat *seat)
 	return seat->user_data;
 }
 
+LIBINPUT_EXPORT void
+libinput_seat_led_update(struct libinput_seat *seat, enum libinput_led leds)
+{
+	struct libinput_device *device;
+
+	seat->leds = leds;
+	seat->leds_set = 1;
+
+	list_for_each(device, &seat->devices_list, link)
+		evdev_device_led_update((struct evdev_device *) device, leds);
+}
+
 LIBINPUT_EXPORT const char *
 libinput_seat_get_physical_name(struct libinput_seat *seat)
 {
@@ -629,22 +722,31 @@ notify_removed_device(struct libinput_device *device)
 			&removed_device_event->base);
 }
 
-void
-keyboard_notify_key(struct libinput_device *device,
-		    uint32_t time,
-		    uint32_t key,
-		    enum libinput_keyboard_key_state state)
+static void
+keyboard_post_key(struct libinput_device *device,
+		  uint32_t time,
+		  uint32_t key,
+		  enum libinput_keyboard_key_state state,
+		  int repeat)
 {
+	struct libinput *libinput = device->seat->libinput;
 	struct libinput_event_keyboard *key_event;
 
-	key_event = zalloc(sizeof *key_event);
+	if (libinput->key_event_pool_count > 0)
+		key_event = (struct libinput_event_keyboard *)
+			libinput->key_event_pool[--libinput->key_event_pool_count];
+	else
+		key_event = malloc(sizeof *key_event);
 	if (!key_event)
 		return;
 
 	*key_event = (struct libinput_event_keyboard) {
 		.time = time,
 		.key = key,
+		.seat_key_count = key < KEY_CNT ?
+			device->seat->key_count[key] : 0,
 		.state = state,
+		.repeat = repeat,
 	};
 
 	post_device_event(device,
@@ -652,6 +754,24 @@ keyboard_notify_key(struct libinput_device *device,
 			  &key_event->base);
 }
 
+void
+keyboard_notify_key(struct libinput_device *device,
+		    uint32_t time,
+		    uint32_t key,
+		    enum libinput_keyboard_key_state state)
+{
+	keyboard_post_key(device, time, key, state, 0);
+}
+
+void
+keyboard_notify_key_repeat(struct libinput_device *device,
+			   uint32_t time,
+			   uint32_t key)
+{
+	keyboard_post_key(device, time, key,
+			  LIBINPUT_KEYBOARD_KEY_STATE_PRESSED, 1);
+}
+
 void
 pointer_notify_motion(struct libinput_device *device,
 		      uint32_t time,
@@ -675,6 +795,37 @@ pointer_notify_motion(struct libinput_device *device,
 			  &motion_event->base);
 }
 
+/* Add relative motion to the most recently queued event, if that is a
+ * motion event of the same device the caller hasn't fetched yet. */
+int
+pointer_merge_motion(struct libinput_device *device,
+		     uint32_t time,
+		     li_fixed_t dx,
+		     li_fixed_t dy)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *motion_event;
+	size_t last;
+
+	if (libinput->events_count == 0)
+		return 0;
+
+	last = (libinput->events_in + libinput->events_len - 1) %
+		libinput->events_len;
+	event = libinput->events[last];
+	if (event->type != LIBINPUT_EVENT_POINTER_MOTION ||
+	    event->device != device)
+		return 0;
+
+	motion_event = (struct libinput_event_pointer *) event;
+	motion_event->time = time;
+	motion_event->x += dx;
+	motion_event->y += dy;
+
+	return 1;
+}
+
 void
 pointer_notify_motion_absolute(struct libinput_device *device,
 			       uint32_t time,
@@ -744,6 +895,47 @@ pointer_notify_axis(struct libinput_device *device,
 			  &axis_event->base);
 }
 
+void
+pointer_notify_scroll(struct libinput_device *device,
+		      uint32_t time,
+		      enum libinput_pointer_scroll_source source,
+		      li_fixed_t dx,
+		      li_fixed_t dy)
+{
+	struct libinput_event_pointer *scroll_event;
+
+	if (device->seat->libinput->legacy_scroll_events) {
+		if (dx != 0)
+			pointer_notify_axis(
+				device,
+				time,
+				LIBINPUT_POINTER_AXIS_HORIZONTAL_SCROLL,
+				dx);
+		if (dy != 0)
+			pointer_notify_axis(
+				device,
+				time,
+				LIBINPUT_POINTER_AXIS_VERTICAL_SCROLL,
+				dy);
+		return;
+	}
+
+	scroll_event = zalloc(sizeof *scroll_event);
+	if (!scroll_event)
+		return;
+
+	*scroll_event = (struct libinput_event_pointer) {
+		.time = time,
+		.x = dx,
+		.y = dy,
+		.source = source,
+	};
+
+	post_device_event(device,
+			  LIBINPUT_EVENT_POINTER_SCROLL,
+			  &scroll_event->base);
+}
+
 void
 touch_notify_touch(struct libinput_device *device,
 		   uint32_t time,
@@ -833,6 +1025,16 @@ libinput_post_event(struct libinput *libinput,
 	libinput->events_count = events_count;
 	events[libinput->events_in] = event;
 	libinput->events_in = (libinput->events_in + 1) % libinput->events_len;
+
+	libinput->events_posted++;
+	if (events_count > libinput->events_high_water_mark)
+		libinput->events_high_water_mark = events_count;
+
+	if (events_count == libinput->queue_threshold.depth &&
+	    libinput->queue_threshold.func)
+		libinput->queue_threshold.func(libinput,
+					       events_count,
+					       libinput->queue_threshold.user_data);
 }
 
 LIBINPUT_EXPORT struct libinput_event *
@@ -847,6 +1049,7 @@ libinput_get_event(struct libinput *libinput)
 	libinput->events_out =
 		(libinput->events_out + 1) % libinput->events_len;
 	libinput->events_count--;
+	libinput->events_consumed++;
 
 	return event;
 }
@@ -863,6 +1066,53 @@ libinput_next_event_type(struct libinput *libinput)
 	return event->type;
 }
 
+LIBINPUT_EXPORT size_t
+libinput_get_queue_depth(struct libinput *libinput)
+{
+	return libinput->events_count;
+}
+
+LIBINPUT_EXPORT size_t
+libinput_get_queue_high_water_mark(struct libinput *libinput)
+{
+	return libinput->events_high_water_mark;
+}
+
+LIBINPUT_EXPORT void
+libinput_reset_queue_high_water_mark(struct libinput *libinput)
+{
+	libinput->events_high_water_mark = libinput->events_count;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_events_posted(struct libinput *libinput)
+{
+	return libinput->events_posted;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_events_consumed(struct libinput *libinput)
+{
+	return libinput->events_consumed;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_queue_threshold(struct libinput *libinput,
+			     size_t threshold,
+			     libinput_queue_threshold_func func,
+			     void *user_data)
+{
+	libinput->queue_threshold.depth = threshold;
+	libinput->queue_threshold.func = threshold ? func : NULL;
+	libinput->queue_threshold.user_data = user_data;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_legacy_scroll_events(struct libinput *libinput, int enable)
+{
+	libinput->legacy_scroll_events = enable;
+}
+
 LIBINPUT_EXPORT void *
 libinput_get_user_data(struct libinput *libinput)
 {
@@ -911,6 +1161,41 @@ libinput_device_get_seat(struct libinput_device *device)
 	return device->seat;
 }
 
+LIBINPUT_EXPORT int
+libinput_device_keyboard_set_repeat(struct libinput_device *device,
+				    uint32_t delay,
+				    uint32_t interval)
+{
+	return evdev_device_set_repeat((struct evdev_device *) device,
+				       delay,
+				       interval);
+}
+
+LIBINPUT_EXPORT int
+libinput_device_pointer_set_max_motion_rate(struct libinput_device *device,
+					    uint32_t rate)
+{
+	return evdev_device_set_max_motion_rate((struct evdev_device *) device,
+						rate);
+}
+
+LIBINPUT_EXPORT int
+libinput_device_touchpad_set_tap(struct libinput_device *device,
+				 enum libinput_touchpad_tap_mode mode,
+				 uint32_t timeout)
+{
+	return evdev_device_set_tap((struct evdev_device *) device,
+				    mode, timeout);
+}
+
+LIBINPUT_EXPORT int
+libinput_device_touchpad_set_kinetic_scroll(struct libinput_device *device,
+					    uint32_t rate)
+{
+	return evdev_device_set_kinetic_scroll((struct evdev_device *) device,
+					       rate);
+}
+
 LIBINPUT_EXPORT void
 libinput_device_led_update(struct libinput_device *device,
 			   enum libinput_led leds)
@@ -98,6 +98,24 @@ enum libinput_pointer_axis {
 	LIBINPUT_POINTER_AXIS_HORIZONTAL_SCROLL = 1
 };
 
+/**
+ * @ingroup device
+ *
+ * The physical source of a scroll event.
+ */
+enum libinput_pointer_scroll_source {
+	/**
+	 * Fingers moving on a touchpad; scrolling stops when the fingers
+	 * are lifted.
+	 */
+	LIBINPUT_POINTER_SCROLL_SOURCE_FINGER = 1,
+	/**
+	 * Kinetic scrolling continuing the motion of the fingers after they
+	 * were lifted, see libinput_device_touchpad_set_kinetic_scroll().
+	 */
+	LIBINPUT_POINTER_SCROLL_SOURCE_KINETIC = 2
+};
+
 /**
  * @ingroup device
  *
@@ -148,6 +166,12 @@ enum libinput_event_type {
 	LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 	LIBINPUT_EVENT_POINTER_BUTTON,
 	LIBINPUT_EVENT_POINTER_AXIS,
+	/**
+	 * Scrolling on both axes at once, e.g. two-finger scrolling on a
+	 * touchpad. Sent instead of a pair of LIBINPUT_EVENT_POINTER_AXIS
+	 * events unless libinput_set_legacy_scroll_events() is enabled.
+	 */
+	LIBINPUT_EVENT_POINTER_SCROLL,
 
 	LIBINPUT_EVENT_TOUCH_TOUCH = 500,
 	/**
@@ -217,6 +241,17 @@ li_fixed_to_int(li_fixed_t f)
 
 /**
  * @defgroup event Acessing and destruction of events
+ *
+ * Event times are in milliseconds of CLOCK_MONOTONIC, truncated to 32
+ * bits, for all devices and for events generated by libinput itself, e.g.
+ * key repeats. They can be compared directly with other timestamps taken
+ * from CLOCK_MONOTONIC, such as the presentation time of a frame.
+ *
+ * Kernels before 3.4 can't be asked to timestamp events with
+ * CLOCK_MONOTONIC. The CLOCK_REALTIME timestamps of their devices are
+ * converted when the events are read, by the offset between the two
+ * clocks at that time. A change of the wall clock between an event and
+ * its being read thus shifts the event time by that change.
  */
 
 /**
@@ -320,7 +355,8 @@ libinput_event_get_device_notify_event(struct libinput_event *event);
 /**
  * @ingroup event_keyboard
  *
- * @return The event time for this event
+ * @return The event time for this event, in milliseconds of
+ * CLOCK_MONOTONIC
  */
 uint32_t
 libinput_event_keyboard_get_time(
@@ -344,6 +380,34 @@ enum libinput_keyboard_key_state
 libinput_event_keyboard_get_key_state(
 	struct libinput_event_keyboard *event);
 
+/**
+ * @ingroup event_keyboard
+ *
+ * For the key of a key event, return the number of devices on the seat
+ * holding that key down, including the device of the event itself. A key
+ * is only released on the seat once this count drops to zero.
+ *
+ * @return The number of devices on the seat holding the key down
+ */
+uint32_t
+libinput_event_keyboard_get_seat_key_count(
+	struct libinput_event_keyboard *event);
+
+/**
+ * @ingroup event_keyboard
+ *
+ * Key events generated by the key repeat of libinput are reported as
+ * presses of the held key, with this flag set. Whether a key should
+ * repeat at all, e.g. modifiers, is up to the caller.
+ *
+ * @return Non-zero if the event was generated by key repeat, zero
+ * otherwise
+ * @see libinput_device_keyboard_set_repeat
+ */
+int
+libinput_event_keyboard_get_repeat(
+	struct libinput_event_keyboard *event);
+
 /**
  * @defgroup event_pointer Pointer events
  *
@@ -354,7 +418,8 @@ libinput_event_keyboard_get_key_state(
 /**
  * @ingroup event_pointer
  *
- * @return The event time for this event
+ * @return The event time for this event, in milliseconds of
+ * CLOCK_MONOTONIC
  */
 uint32_t
 libinput_event_pointer_get_time(
@@ -499,6 +564,43 @@ li_fixed_t
 libinput_event_pointer_get_axis_value(
 	struct libinput_event_pointer *event);
 
+/**
+ * @ingroup event_pointer
+ *
+ * Return the scroll value of the given axis, in the same units as
+ * libinput_event_pointer_get_axis_value(). An axis that didn't scroll
+ * has the value 0.
+ *
+ * For pointer events that are not of type LIBINPUT_EVENT_POINTER_SCROLL,
+ * this function returns 0.
+ *
+ * @note It is an application bug to call this function for events other than
+ * LIBINPUT_EVENT_POINTER_SCROLL.
+ *
+ * @return the scroll value of the axis
+ */
+li_fixed_t
+libinput_event_pointer_get_scroll_value(
+	struct libinput_event_pointer *event,
+	enum libinput_pointer_axis axis);
+
+/**
+ * @ingroup event_pointer
+ *
+ * Return the source of the scroll event.
+ *
+ * For pointer events that are not of type LIBINPUT_EVENT_POINTER_SCROLL,
+ * this function returns 0.
+ *
+ * @note It is an application bug to call this function for events other than
+ * LIBINPUT_EVENT_POINTER_SCROLL.
+ *
+ * @return the source of the scroll event
+ */
+enum libinput_pointer_scroll_source
+libinput_event_pointer_get_scroll_source(
+	struct libinput_event_pointer *event);
+
 /**
  * @defgroup event_touch Touch events
  *
@@ -508,7 +610,8 @@ libinput_event_pointer_get_axis_value(
 /**
  * @ingroup event_touch
  *
- * @return The event time for this event
+ * @return The event time for this event, in milliseconds of
+ * CLOCK_MONOTONIC
  */
 uint32_t
 libinput_event_touch_get_time(
@@ -614,6 +717,40 @@ libinput_create_from_udev(const struct libinput_interface *interface,
 			  void *user_data,
 			  struct udev *udev,
 			  const char *seat_id);
+
+/**
+ * @ingroup base
+ *
+ * Create a new libinput context from udev like
+ * libinput_create_from_udev(), opening and probing the devices present
+ * at creation and at every later resume with up to max_open_threads
+ * threads. Devices are still added to their seats in a deterministic
+ * order.
+ *
+ * If max_open_threads is greater than 1, the open_restricted callback
+ * may be called from several threads at the same time, and must be
+ * thread-safe. A value of 0 or 1 opens all devices sequentially from the
+ * calling thread.
+ *
+ * @param interface The callback interface
+ * @param user_data Caller-specific data passed to the various callback
+ * interfaces.
+ * @param udev An already initialized udev context
+ * @param seat_id A seat identifier. This string must not be NULL.
+ * @param max_open_threads The maximum number of threads, including the
+ * calling one
+ *
+ * @return An initialized libinput context, ready to handle events or NULL on
+ * error.
+ *
+ * @see libinput_udev_set_max_open_threads
+ */
+struct libinput *
+libinput_create_from_udev_threaded(const struct libinput_interface *interface,
+				   void *user_data,
+				   struct udev *udev,
+				   const char *seat_id,
+				   unsigned int max_open_threads);
 /**
  * @ingroup base
  *
@@ -634,6 +771,31 @@ libinput_create_from_path(const struct libinput_interface *interface,
 			  void *user_data,
 			  const char *path);
 
+/**
+ * @ingroup base
+ *
+ * Change the maximum number of threads libinput may use to open and
+ * probe devices concurrently when a context created from udev adds the
+ * devices present at resume time. To open the devices present at
+ * creation concurrently, create the context with
+ * libinput_create_from_udev_threaded() instead.
+ *
+ * If this is greater than 1, the open_restricted callback may be called
+ * from several threads at the same time, and must be thread-safe. A
+ * value of 0 or 1, the default of libinput_create_from_udev(), opens all
+ * devices sequentially from the calling thread.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param max_threads The maximum number of threads, including the
+ * calling one
+ *
+ * @return 0 on success, or -1 if the context was not created with
+ * libinput_create_from_udev()
+ */
+int
+libinput_udev_set_max_open_threads(struct libinput *libinput,
+				   unsigned int max_threads);
+
 /**
  * @ingroup base
  *
@@ -689,6 +851,111 @@ libinput_get_event(struct libinput *libinput);
 enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Return the number of events in the internal queue, i.e. the number of
+ * events libinput_get_event() would return before returning NULL.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The number of queued events
+ */
+size_t
+libinput_get_queue_depth(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Return the largest number of events that were queued at the same time
+ * since the context was created or since the last call to
+ * libinput_reset_queue_high_water_mark().
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The high-water mark of the event queue
+ */
+size_t
+libinput_get_queue_high_water_mark(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Reset the high-water mark of the event queue to the current queue
+ * depth.
+ *
+ * @param libinput A previously initialized libinput context
+ */
+void
+libinput_reset_queue_high_water_mark(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The total number of events queued since the context was created
+ */
+uint64_t
+libinput_get_events_posted(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The total number of events returned by libinput_get_event()
+ * since the context was created
+ */
+uint64_t
+libinput_get_events_consumed(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Function called when the event queue grows to the threshold set with
+ * libinput_set_queue_threshold().
+ *
+ * @param libinput The libinput context
+ * @param depth The number of queued events
+ * @param user_data The data passed to libinput_set_queue_threshold()
+ */
+typedef void (*libinput_queue_threshold_func)(struct libinput *libinput,
+					      size_t depth,
+					      void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Have func called whenever the number of queued events grows to
+ * threshold, e.g. to shed work while the caller falls behind. The
+ * function is called as the queue crosses the threshold, not for every
+ * event beyond it, from within whichever call queued the event. Besides
+ * libinput_dispatch(), that includes libinput_suspend(),
+ * libinput_resume() and libinput_destroy(), which queue device added and
+ * removed events. It must not call back into libinput.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param threshold The queue depth to call func at, or 0 to disable
+ * @param func The function to call
+ * @param user_data Caller-specific data passed to func
+ */
+void
+libinput_set_queue_threshold(struct libinput *libinput,
+			     size_t threshold,
+			     libinput_queue_threshold_func func,
+			     void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Have scrolling on both axes reported as one LIBINPUT_EVENT_POINTER_AXIS
+ * event per axis instead of a LIBINPUT_EVENT_POINTER_SCROLL event, for
+ * callers that don't handle the latter. Disabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to send per-axis events, zero to send scroll
+ * events
+ */
+void
+libinput_set_legacy_scroll_events(struct libinput *libinput, int enable);
+
 /**
  * @ingroup base
  *
@@ -845,6 +1112,21 @@ libinput_seat_get_physical_name(struct libinput_seat *seat);
 const char *
 libinput_seat_get_logical_name(struct libinput_seat *seat);
 
+/**
+ * @ingroup seat
+ *
+ * Update the LEDs on all keyboards of the seat. Only LEDs whose state
+ * differs from the current state of a keyboard are written to it,
+ * and keyboards added to the seat later are set to the same state.
+ *
+ * @param seat A previously obtained seat
+ * @param leds A mask of the LEDs to set, or unset.
+ * @see libinput_device_led_update
+ */
+void
+libinput_seat_led_update(struct libinput_seat *seat,
+			 enum libinput_led leds);
+
 /**
  * @defgroup device Initialization and manipulation of input devices
  */
@@ -944,6 +1226,12 @@ libinput_device_get_seat(struct libinput_device *device);
  * LEDs, or does not have one or more of the LEDs given in the mask, this
  * function does nothing.
  *
+ * Only the LEDs that differ from the current state of the device are
+ * written. The state is tracked from the LED changes the kernel reports
+ * for the device, so LEDs changed by other clients are taken into
+ * account once libinput_dispatch() has processed them. To update all
+ * keyboards of a seat at once, use libinput_seat_led_update().
+ *
  * @param device A previously obtained device
  * @param leds A mask of the LEDs to set, or unset.
  */
@@ -954,12 +1242,121 @@ libinput_device_led_update(struct libinput_device *device,
 /**
  * @ingroup device
  *
- * Set the bitmask in keys to the bitmask of the keys present on the device
- * (see linux/input.h), up to size characters.
+ * Limit the rate of relative motion events of a pointer device. Motion
+ * arriving faster than the given rate is accumulated, without losing
+ * sub-pixel motion, and reported as one event once the interval has
+ * passed or before any other event of the device. Motion is also added
+ * to a motion event of the device that is still queued and hasn't been
+ * fetched by the caller, so that a slow caller gets one motion event per
+ * libinput_get_event() cycle.
+ *
+ * This is intended for mice polling at rates far above the refresh rate
+ * of the display.
+ *
+ * @param device A current input device
+ * @param rate Maximum number of motion events per second, or 0 to report
+ * every motion
+ * @return 0 on success, or -1 if the device is not a pointer device
+ */
+int
+libinput_device_pointer_set_max_motion_rate(struct libinput_device *device,
+					    uint32_t rate);
+
+/**
+ * @ingroup device
+ *
+ * How a tap on a touchpad is turned into a button click.
+ */
+enum libinput_touchpad_tap_mode {
+	/**
+	 * The button press and release are both sent once the tap
+	 * timeout has passed without another touch, so a tap is never
+	 * taken back.
+	 */
+	LIBINPUT_TOUCHPAD_TAP_DEFERRED = 0,
+	/**
+	 * The button press is sent as soon as the finger is lifted. If the
+	 * finger touches down again within the tap timeout, the button is
+	 * held for a drag, or released and clicked again for a double tap.
+	 * Otherwise it is released when the timeout has passed.
+	 */
+	LIBINPUT_TOUCHPAD_TAP_IMMEDIATE = 1,
+};
+
+/**
+ * @ingroup device
+ *
+ * Configure tap-to-click of a touchpad. The timeout is the time after a
+ * tap within which a second touch makes a double tap or a drag. Tapping
+ * is not available on clickpads, where this has no effect.
+ *
+ * @param device A current input device
+ * @param mode When to send the button press of a tap
+ * @param timeout The tap timeout in milliseconds, or 0 for the default
+ * @return 0 on success, or -1 if the device is not a touchpad
+ */
+int
+libinput_device_touchpad_set_tap(struct libinput_device *device,
+				 enum libinput_touchpad_tap_mode mode,
+				 uint32_t timeout);
+
+/**
+ * @ingroup device
+ *
+ * Enable kinetic scrolling on a touchpad. When the fingers are lifted
+ * during two-finger scrolling, scroll events with the source
+ * LIBINPUT_POINTER_SCROLL_SOURCE_KINETIC continue the scroll at the
+ * velocity of the fingers, slowing down until they come to a halt. They
+ * are sent at most at the given rate, from within libinput_dispatch().
+ * Touching the touchpad again stops kinetic scrolling.
+ *
+ * @param device A current input device
+ * @param rate Kinetic scroll events per second, or 0 to disable kinetic
+ * scrolling
+ * @return 0 on success, or -1 if the device is not a touchpad
+ */
+int
+libinput_device_touchpad_set_kinetic_scroll(struct libinput_device *device,
+					    uint32_t rate);
+
+/**
+ * @ingroup device
+ *
+ * Enable key repeat in libinput for a keyboard. Once a key has been held
+ * down for delay milliseconds, a key event with the repeat flag set is
+ * generated every interval milliseconds until the key is released or
+ * another key is pressed. The repeat events are timed by libinput, not
+ * by the arrival of kernel events.
+ *
+ * The repeat settings of the kernel device are left alone, as they are
+ * shared with other clients of the device. Key repeat events from the
+ * kernel are always discarded by libinput.
+ *
+ * @param device A current input device
+ * @param delay Time in milliseconds before the first repeat, or 0 to
+ * disable key repeat
+ * @param interval Time in milliseconds between repeats
+ * @return 0 on success, or -1 if the device is not a keyboard or the
+ * interval is 0
+ * @see libinput_event_keyboard_get_repeat
+ */
+int
+libinput_device_keyboard_set_repeat(struct libinput_device *device,
+				    uint32_t delay,
+				    uint32_t interval);
+
+/**
+ * @ingroup device
+ *
+ * Set the bitmask in keys to the bitmask of the keys currently held down
+ * on the device (see linux/input.h), up to size characters. The state is
+ * the one reflected by the events processed so far, not the one of the
+ * kernel device, and is returned without calling into the kernel.
  *
  * @param device A current input device
  * @param keys An array filled with the bitmask for the keys
  * @param size Size of the keys array
+ * @return The number of bytes filled in
  */
 int
 libinput_device_get_keys(struct libinput_device *device,
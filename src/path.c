@@ -77,7 +77,8 @@ static int
 path_get_udev_properties(const char *path,
 			 char **syspath,
 			 char **seat_name,
-			 char **seat_logical_name)
+			 char **seat_logical_name,
+			 enum evdev_device_udev_tags *udev_tags)
 {
 	struct udev *udev = NULL;
 	struct udev_device *device = NULL;
@@ -97,6 +98,7 @@ path_get_udev_properties(const char *path,
 		goto out;
 
 	*syspath = strdup(udev_device_get_syspath(device));
+	*udev_tags = evdev_device_get_udev_tags(device);
 
 	seat = udev_device_get_property_value(device, "ID_SEAT");
 	*seat_name = strdup(seat ? seat : default_seat);
@@ -124,6 +126,7 @@ path_input_enable(struct libinput *libinput)
 	char *syspath;
 	int fd;
 	char *seat_name, *seat_logical_name;
+	enum evdev_device_udev_tags udev_tags;
 
 	if (input->device)
 		return 0;
@@ -135,7 +138,8 @@ path_input_enable(struct libinput *libinput)
 	}
 
 	if (path_get_udev_properties(devnode, &syspath,
-				     &seat_name, &seat_logical_name) == -1) {
+				     &seat_name, &seat_logical_name,
+				     &udev_tags) == -1) {
 		close_restricted(libinput, fd);
 		log_info("failed to obtain syspath for device '%s'.\n", devnode);
 		return -1;
@@ -145,7 +149,8 @@ path_input_enable(struct libinput *libinput)
 	free(seat_name);
 	free(seat_logical_name);
 
-	device = evdev_device_create(&seat->base, devnode, syspath, fd);
+	device = evdev_device_create(&seat->base, devnode, syspath, fd, NULL,
+				     udev_tags);
 	free(syspath);
 	libinput_seat_unref(&seat->base);
 
@@ -0,0 +1,475 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <ctype.h>
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "evdev.h"
+#include "libinput-private.h"
+#include "touchpad-quirks.h"
+
+#define TOUCHPAD_QUIRKS_LINE_MAX 256
+
+/* Default values */
+#define DEFAULT_CONSTANT_ACCEL_NUMERATOR 50
+#define DEFAULT_MIN_ACCEL_FACTOR 0.16
+#define DEFAULT_MAX_ACCEL_FACTOR 1.0
+#define DEFAULT_HYSTERESIS_MARGIN_DENOMINATOR 700.0
+
+/* Number of samples the velocity of a touch is estimated from. The
+ * history can hold up to TOUCHPAD_HISTORY_MAX samples. */
+#define DEFAULT_TOUCHPAD_HISTORY_LENGTH 4
+
+/* Used for touchpads without an entry, and for the keys an entry leaves
+ * out. The pressure thresholds are the magic numbers of
+ * xf86-input-synaptics. */
+static const struct touchpad_quirks touchpad_default_quirks = {
+	.model = TOUCHPAD_MODEL_UNKNOWN,
+	.touch_low = { 0, 25.0/256.0 },
+	.touch_high = { 0, 30.0/256.0 },
+	.hysteresis_margin_denominator = DEFAULT_HYSTERESIS_MARGIN_DENOMINATOR,
+	.constant_accel_numerator = DEFAULT_CONSTANT_ACCEL_NUMERATOR,
+	.min_accel_factor = DEFAULT_MIN_ACCEL_FACTOR,
+	.max_accel_factor = DEFAULT_MAX_ACCEL_FACTOR,
+	.history_length = DEFAULT_TOUCHPAD_HISTORY_LENGTH,
+};
+
+static const struct {
+	const char *name;
+	enum touchpad_model model;
+} touchpad_models[] = {
+	{ "unknown", TOUCHPAD_MODEL_UNKNOWN },
+	{ "synaptics", TOUCHPAD_MODEL_SYNAPTICS },
+	{ "alps", TOUCHPAD_MODEL_ALPS },
+	{ "appletouch", TOUCHPAD_MODEL_APPLETOUCH },
+	{ "elantech", TOUCHPAD_MODEL_ELANTECH },
+};
+
+struct quirks_parser {
+	const char *path;
+	int line;
+
+	struct touchpad_quirks quirks;
+	char section[TOUCHPAD_QUIRKS_LINE_MAX];
+	int in_section;
+	int has_vendor;
+};
+
+static unsigned int
+touchpad_quirks_hash(uint16_t vendor, uint16_t product)
+{
+	uint32_t key = (uint32_t) vendor << 16 | product;
+
+	/* Multiplicative hashing; the top bits are the best mixed. */
+	return (key * 2654435761u) >> (32 - TOUCHPAD_QUIRKS_HASH_BITS);
+}
+
+static struct list *
+touchpad_quirks_bucket(struct libinput *libinput,
+		       uint16_t vendor, uint16_t product)
+{
+	return &libinput->touchpad_quirks[touchpad_quirks_hash(vendor,
+							       product)];
+}
+
+/* The entry for exactly these ids and name pattern. */
+static struct touchpad_quirks *
+touchpad_quirks_find(struct libinput *libinput,
+		     uint16_t vendor, uint16_t product,
+		     const char *pattern)
+{
+	struct touchpad_quirks *quirks;
+
+	list_for_each(quirks,
+		      touchpad_quirks_bucket(libinput, vendor, product),
+		      link) {
+		if (quirks->vendor == vendor && quirks->product == product &&
+		    strcmp(quirks->name, pattern) == 0)
+			return quirks;
+	}
+
+	return NULL;
+}
+
+/* The entry for these ids that matches the name best. Entries are kept
+ * in the order of the file. */
+static const struct touchpad_quirks *
+touchpad_quirks_match(struct libinput *libinput,
+		      uint16_t vendor, uint16_t product,
+		      const char *name)
+{
+	const struct touchpad_quirks *quirks, *any_name = NULL;
+
+	list_for_each(quirks,
+		      touchpad_quirks_bucket(libinput, vendor, product),
+		      link) {
+		if (quirks->vendor != vendor || quirks->product != product)
+			continue;
+
+		if (quirks->name[0] == '\0') {
+			if (!any_name)
+				any_name = quirks;
+		} else if (name && fnmatch(quirks->name, name, 0) == 0) {
+			return quirks;
+		}
+	}
+
+	return any_name;
+}
+
+/* Parse a decimal number. Unlike strtod(), this doesn't depend on the
+ * locale of the process using libinput. */
+static int
+parse_double(const char *str, double *value)
+{
+	double sign = 1.0, scale = 1.0, v = 0.0;
+	int digits = 0;
+
+	if (*str == '-') {
+		sign = -1.0;
+		str++;
+	}
+
+	for (; isdigit((unsigned char) *str); str++, digits++)
+		v = v * 10 + (*str - '0');
+
+	if (*str == '.') {
+		for (str++; isdigit((unsigned char) *str); str++, digits++) {
+			scale /= 10;
+			v += (*str - '0') * scale;
+		}
+	}
+
+	if (digits == 0 || *str != '\0')
+		return -1;
+
+	*value = sign * v;
+	return 0;
+}
+
+static int
+parse_int(const char *str, long min, long max, long *value)
+{
+	char *end;
+	long v;
+
+	v = strtol(str, &end, 0);
+	if (end == str || *end != '\0' || v < min || v > max)
+		return -1;
+
+	*value = v;
+	return 0;
+}
+
+/* Split a value into two whitespace separated fields. */
+static int
+parse_pair(const char *str, char *first, char *second)
+{
+	char rest;
+
+	if (sscanf(str, "%63s %63s %c", first, second, &rest) != 2)
+		return -1;
+
+	return 0;
+}
+
+static int
+parse_pressure(const char *str, struct touchpad_pressure_quirk *quirk)
+{
+	char offset[64], fraction[64];
+	long o;
+	double f;
+
+	if (parse_pair(str, offset, fraction) != 0 ||
+	    parse_int(offset, -65535, 65535, &o) != 0 ||
+	    parse_double(fraction, &f) != 0 ||
+	    f < 0.0 || f > 1.0)
+		return -1;
+
+	quirk->offset = o;
+	quirk->fraction = f;
+	return 0;
+}
+
+static int
+parse_positive_double(const char *str, double *value)
+{
+	double v;
+
+	if (parse_double(str, &v) != 0 || v <= 0.0)
+		return -1;
+
+	*value = v;
+	return 0;
+}
+
+static int
+parse_model(const char *str, enum touchpad_model *model)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_LENGTH(touchpad_models); i++) {
+		if (strcmp(str, touchpad_models[i].name) == 0) {
+			*model = touchpad_models[i].model;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static int
+parse_key(struct quirks_parser *parser, const char *key, const char *value)
+{
+	struct touchpad_quirks *quirks = &parser->quirks;
+	char x[64], y[64];
+	long v, rx, ry;
+
+	if (strcmp(key, "Vendor") == 0) {
+		if (parse_int(value, 0, UINT16_MAX, &v) != 0)
+			return -1;
+		quirks->vendor = v;
+		parser->has_vendor = 1;
+	} else if (strcmp(key, "Product") == 0) {
+		if (parse_int(value, 0, UINT16_MAX, &v) != 0)
+			return -1;
+		quirks->product = v;
+	} else if (strcmp(key, "Name") == 0) {
+		if (*value == '\0' ||
+		    strlen(value) >= sizeof quirks->name)
+			return -1;
+		strcpy(quirks->name, value);
+	} else if (strcmp(key, "Model") == 0) {
+		return parse_model(value, &quirks->model);
+	} else if (strcmp(key, "TouchLow") == 0) {
+		return parse_pressure(value, &quirks->touch_low);
+	} else if (strcmp(key, "TouchHigh") == 0) {
+		return parse_pressure(value, &quirks->touch_high);
+	} else if (strcmp(key, "HysteresisMarginDenominator") == 0) {
+		return parse_positive_double(
+			value, &quirks->hysteresis_margin_denominator);
+	} else if (strcmp(key, "ConstantAccelNumerator") == 0) {
+		return parse_positive_double(
+			value, &quirks->constant_accel_numerator);
+	} else if (strcmp(key, "MinAccelFactor") == 0) {
+		return parse_positive_double(value, &quirks->min_accel_factor);
+	} else if (strcmp(key, "MaxAccelFactor") == 0) {
+		return parse_positive_double(value, &quirks->max_accel_factor);
+	} else if (strcmp(key, "HistoryLength") == 0) {
+		if (parse_int(value, 2, TOUCHPAD_HISTORY_MAX, &v) != 0)
+			return -1;
+		quirks->history_length = v;
+	} else if (strcmp(key, "Resolution") == 0) {
+		if (parse_pair(value, x, y) != 0 ||
+		    parse_int(x, 1, INT32_MAX, &rx) != 0 ||
+		    parse_int(y, 1, INT32_MAX, &ry) != 0)
+			return -1;
+		quirks->resolution_x = rx;
+		quirks->resolution_y = ry;
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+finish_section(struct libinput *libinput, struct quirks_parser *parser)
+{
+	struct touchpad_quirks *quirks;
+	struct list *bucket;
+
+	if (!parser->in_section)
+		return;
+	parser->in_section = 0;
+
+	if (!parser->has_vendor) {
+		log_info("%s: section [%s] has no Vendor, ignored\n",
+			 parser->path, parser->section);
+		return;
+	}
+
+	if (parser->quirks.min_accel_factor >
+	    parser->quirks.max_accel_factor) {
+		log_info("%s: section [%s] has MinAccelFactor above "
+			 "MaxAccelFactor, ignored\n",
+			 parser->path, parser->section);
+		return;
+	}
+
+	if (touchpad_quirks_find(libinput,
+				 parser->quirks.vendor,
+				 parser->quirks.product,
+				 parser->quirks.name)) {
+		log_info("%s: section [%s] matches the same touchpads as an "
+			 "earlier one, ignored\n",
+			 parser->path, parser->section);
+		return;
+	}
+
+	quirks = malloc(sizeof *quirks);
+	if (!quirks)
+		return;
+
+	*quirks = parser->quirks;
+	bucket = touchpad_quirks_bucket(libinput,
+					quirks->vendor, quirks->product);
+	list_insert(bucket->prev, &quirks->link);
+}
+
+static char *
+strip(char *str)
+{
+	char *end;
+
+	while (isspace((unsigned char) *str))
+		str++;
+
+	end = str + strlen(str);
+	while (end > str && isspace((unsigned char) end[-1]))
+		end--;
+	*end = '\0';
+
+	return str;
+}
+
+static void
+parse_line(struct libinput *libinput, struct quirks_parser *parser,
+	   char *line)
+{
+	char *key, *value, *end;
+
+	line = strip(line);
+	if (*line == '\0' || *line == '#')
+		return;
+
+	if (*line == '[') {
+		end = strchr(line, ']');
+		if (!end || end[1] != '\0') {
+			log_info("%s:%d: malformed section header\n",
+				 parser->path, parser->line);
+			return;
+		}
+
+		finish_section(libinput, parser);
+
+		*end = '\0';
+		snprintf(parser->section, sizeof parser->section,
+			 "%s", line + 1);
+		parser->quirks = touchpad_default_quirks;
+		parser->in_section = 1;
+		parser->has_vendor = 0;
+		return;
+	}
+
+	value = strchr(line, '=');
+	if (!value || !parser->in_section) {
+		log_info("%s:%d: expected a key=value pair in a section\n",
+			 parser->path, parser->line);
+		return;
+	}
+
+	*value = '\0';
+	key = strip(line);
+	value = strip(value + 1);
+
+	if (parse_key(parser, key, value) != 0)
+		log_info("%s:%d: invalid %s '%s', ignored\n",
+			 parser->path, parser->line, key, value);
+}
+
+void
+touchpad_quirks_init(struct libinput *libinput)
+{
+	struct quirks_parser parser;
+	char line[TOUCHPAD_QUIRKS_LINE_MAX];
+	FILE *file;
+	int i;
+
+	for (i = 0; i < TOUCHPAD_QUIRKS_HASH_SIZE; i++)
+		list_init(&libinput->touchpad_quirks[i]);
+
+	memset(&parser, 0, sizeof parser);
+	parser.path = getenv(TOUCHPAD_QUIRKS_FILE_ENV);
+	if (!parser.path)
+		parser.path = TOUCHPAD_QUIRKS_FILE;
+
+	file = fopen(parser.path, "r");
+	if (!file) {
+		log_info("failed to open touchpad quirks '%s', "
+			 "using the defaults\n", parser.path);
+		return;
+	}
+
+	while (fgets(line, sizeof line, file)) {
+		parser.line++;
+
+		if (!strchr(line, '\n') && !feof(file)) {
+			log_info("%s:%d: line too long, ignored\n",
+				 parser.path, parser.line);
+			while (fgets(line, sizeof line, file) &&
+			       !strchr(line, '\n'))
+				;
+			continue;
+		}
+
+		parse_line(libinput, &parser, line);
+	}
+	finish_section(libinput, &parser);
+
+	fclose(file);
+}
+
+void
+touchpad_quirks_destroy(struct libinput *libinput)
+{
+	struct touchpad_quirks *quirks, *next;
+	int i;
+
+	for (i = 0; i < TOUCHPAD_QUIRKS_HASH_SIZE; i++) {
+		list_for_each_safe(quirks, next,
+				   &libinput->touchpad_quirks[i], link)
+			free(quirks);
+		list_init(&libinput->touchpad_quirks[i]);
+	}
+}
+
+const struct touchpad_quirks *
+touchpad_quirks_lookup(struct libinput *libinput,
+		       uint16_t vendor, uint16_t product,
+		       const char *name)
+{
+	const struct touchpad_quirks *quirks;
+
+	quirks = touchpad_quirks_match(libinput, vendor, product, name);
+	if (!quirks)
+		quirks = touchpad_quirks_match(libinput, vendor, 0, name);
+	if (!quirks)
+		quirks = &touchpad_default_quirks;
+
+	return quirks;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef TOUCHPAD_QUIRKS_H
+#define TOUCHPAD_QUIRKS_H
+
+#include <stdint.h>
+
+#include "libinput-util.h"
+
+struct libinput;
+
+/* Number of buckets of the per-context quirks hash table. */
+#define TOUCHPAD_QUIRKS_HASH_BITS 6
+#define TOUCHPAD_QUIRKS_HASH_SIZE (1 << TOUCHPAD_QUIRKS_HASH_BITS)
+
+/* Maximum length of the device name pattern of an entry, including the
+ * terminating nul. */
+#define TOUCHPAD_QUIRKS_NAME_MAX 128
+
+/* Environment variable naming a quirks file to read instead of the
+ * installed one. */
+#define TOUCHPAD_QUIRKS_FILE_ENV "LIBINPUT_TOUCHPAD_QUIRKS"
+
+enum touchpad_model {
+	TOUCHPAD_MODEL_UNKNOWN = 0,
+	TOUCHPAD_MODEL_SYNAPTICS,
+	TOUCHPAD_MODEL_ALPS,
+	TOUCHPAD_MODEL_APPLETOUCH,
+	TOUCHPAD_MODEL_ELANTECH
+};
+
+/* A pressure threshold of minimum + offset + range * fraction of the
+ * pressure axis. */
+struct touchpad_pressure_quirk {
+	int32_t offset;
+	double fraction;
+};
+
+/* Tuning of a touchpad model, read from the quirks file. */
+struct touchpad_quirks {
+	struct list link; /* in a bucket of libinput->touchpad_quirks */
+
+	uint16_t vendor;
+	uint16_t product; /* 0 matches any product of the vendor */
+	/* fnmatch(3) pattern of the device name, empty to match any name */
+	char name[TOUCHPAD_QUIRKS_NAME_MAX];
+	enum touchpad_model model;
+
+	struct touchpad_pressure_quirk touch_low;
+	struct touchpad_pressure_quirk touch_high;
+	double hysteresis_margin_denominator;
+	double constant_accel_numerator;
+	double min_accel_factor;
+	double max_accel_factor;
+	unsigned int history_length;
+
+	/* Resolution (units/mm) to use instead of the one reported by the
+	 * kernel, or 0 to use the reported one. */
+	int32_t resolution_x;
+	int32_t resolution_y;
+};
+
+/* Read the quirks file of the context, which is the file named by
+ * TOUCHPAD_QUIRKS_FILE_ENV if set, and the installed one otherwise.
+ * Malformed sections and lines are logged and skipped. A missing file
+ * leaves only the defaults. */
+void
+touchpad_quirks_init(struct libinput *libinput);
+
+void
+touchpad_quirks_destroy(struct libinput *libinput);
+
+/* Look up the quirks of a touchpad, falling back to the entries matching
+ * any product of the vendor, then to the defaults. Of the entries with
+ * the same ids, the first one whose name pattern matches name is taken
+ * before one without a pattern. A NULL name only matches entries without
+ * a pattern. Never returns NULL. */
+const struct touchpad_quirks *
+touchpad_quirks_lookup(struct libinput *libinput,
+		       uint16_t vendor, uint16_t product,
+		       const char *name);
+
+#endif /* TOUCHPAD_QUIRKS_H */
@@ -27,6 +27,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
 
 #include "evdev.h"
 #include "udev-seat.h"
@@ -34,6 +35,8 @@
 static const char default_seat[] = "seat0";
 static const char default_seat_name[] = "default";
 
+#define UDEV_INPUT_MAX_OPEN_THREADS 16
+
 static struct udev_seat *
 udev_seat_create(struct udev_input *input,
 		 const char *device_seat,
@@ -41,8 +44,57 @@ udev_seat_create(struct udev_input *input,
 static struct udev_seat *
 udev_seat_get_named(struct udev_input *input, const char *seat_name);
 
+/* A device found while enumerating, opened and probed ahead of being
+ * added to its seat. libudev objects are not thread-safe, so the worker
+ * threads only see the device node, which is resolved beforehand. */
+struct udev_input_pending {
+	struct udev_device *udev_device;
+	char *devnode;
+	int fd;
+	struct evdev_device_bits bits;
+};
+
+struct udev_input_open_queue {
+	struct libinput *libinput;
+	struct udev_input_pending *pending;
+	size_t count;
+	size_t next;
+	pthread_mutex_t lock;
+};
+
 static int
-device_added(struct udev_device *udev_device, struct udev_input *input)
+device_in_seat(struct udev_device *udev_device, struct udev_input *input)
+{
+	const char *device_seat;
+
+	device_seat = udev_device_get_property_value(udev_device, "ID_SEAT");
+	if (!device_seat)
+		device_seat = default_seat;
+
+	return strcmp(device_seat, input->seat_id) == 0;
+}
+
+static int
+device_is_handled(struct udev_device *udev_device)
+{
+	return evdev_udev_tags_is_handled(
+		evdev_device_get_udev_tags(udev_device));
+}
+
+static int
+device_open(struct libinput *libinput, const char *devnode)
+{
+	/* Use non-blocking mode so that we can loop on read on
+	 * evdev_device_data() until all events on the fd are
+	 * read. */
+	return open_restricted(libinput, devnode, O_RDWR | O_NONBLOCK);
+}
+
+static int
+device_added_fd(struct udev_device *udev_device,
+		struct udev_input *input,
+		int fd,
+		const struct evdev_device_bits *bits)
 {
 	struct libinput *libinput = &input->base;
 	struct evdev_device *device;
@@ -50,19 +102,21 @@ device_added(struct udev_device *udev_device, struct udev_input *input)
 	const char *sysname;
 	const char *device_seat, *seat_name, *output_name;
 	const char *calibration_values;
-	int fd;
 	struct udev_seat *seat;
 
 	device_seat = udev_device_get_property_value(udev_device, "ID_SEAT");
 	if (!device_seat)
 		device_seat = default_seat;
 
-	if (strcmp(device_seat, input->seat_id))
-		return 0;
-
 	devnode = udev_device_get_devnode(udev_device);
 	sysname = udev_device_get_sysname(udev_device);
 
+	if (fd < 0) {
+		log_info("opening input device '%s' failed (%s).\n",
+			 devnode, strerror(-fd));
+		return 0;
+	}
+
 	/* Search for matching logical seat */
 	seat_name = udev_device_get_property_value(udev_device, "WL_SEAT");
 	if (!seat_name)
@@ -74,22 +128,14 @@ device_added(struct udev_device *udev_device, struct udev_input *input)
 		libinput_seat_ref(&seat->base);
 	else {
 		seat = udev_seat_create(input, device_seat, seat_name);
-		if (!seat)
+		if (!seat) {
+			close_restricted(libinput, fd);
 			return -1;
+		}
 	}
 
-	/* Use non-blocking mode so that we can loop on read on
-	 * evdev_device_data() until all events on the fd are
-	 * read.  mtdev_get() also expects this. */
-	fd = open_restricted(libinput, devnode, O_RDWR | O_NONBLOCK);
-	if (fd < 0) {
-		log_info("opening input device '%s' failed (%s).\n",
-			 devnode, strerror(-fd));
-		libinput_seat_unref(&seat->base);
-		return 0;
-	}
-
-	device = evdev_device_create(&seat->base, devnode, sysname, fd);
+	device = evdev_device_create(&seat->base, devnode, sysname, fd, bits,
+				     evdev_device_get_udev_tags(udev_device));
 	libinput_seat_unref(&seat->base);
 
 	if (device == EVDEV_UNHANDLED_DEVICE) {
@@ -131,13 +177,91 @@ device_added(struct udev_device *udev_device, struct udev_input *input)
 	return 0;
 }
 
+static int
+device_added(struct udev_device *udev_device, struct udev_input *input)
+{
+	int fd;
+
+	if (!device_in_seat(udev_device, input) ||
+	    !device_is_handled(udev_device))
+		return 0;
+
+	fd = device_open(&input->base,
+			 udev_device_get_devnode(udev_device));
+
+	return device_added_fd(udev_device, input, fd, NULL);
+}
+
+static void *
+udev_input_open_worker(void *data)
+{
+	struct udev_input_open_queue *queue = data;
+	struct udev_input_pending *pending;
+
+	for (;;) {
+		pthread_mutex_lock(&queue->lock);
+		if (queue->next == queue->count) {
+			pthread_mutex_unlock(&queue->lock);
+			break;
+		}
+		pending = &queue->pending[queue->next++];
+		pthread_mutex_unlock(&queue->lock);
+
+		pending->fd = device_open(queue->libinput, pending->devnode);
+		if (pending->fd >= 0)
+			evdev_device_read_bits(pending->fd, &pending->bits);
+	}
+
+	return NULL;
+}
+
+/* Open and probe the pending devices using up to max_threads threads,
+ * including the calling one. */
+static void
+udev_input_open_devices(struct udev_input *input,
+			struct udev_input_pending *pending,
+			size_t count,
+			unsigned int max_threads)
+{
+	struct udev_input_open_queue queue;
+	pthread_t threads[UDEV_INPUT_MAX_OPEN_THREADS];
+	unsigned int nthreads = 0;
+
+	if (max_threads > UDEV_INPUT_MAX_OPEN_THREADS)
+		max_threads = UDEV_INPUT_MAX_OPEN_THREADS;
+	if (max_threads > count)
+		max_threads = count;
+
+	queue.libinput = &input->base;
+	queue.pending = pending;
+	queue.count = count;
+	queue.next = 0;
+	pthread_mutex_init(&queue.lock, NULL);
+
+	while (nthreads + 1 < max_threads &&
+	       pthread_create(&threads[nthreads], NULL,
+			      udev_input_open_worker, &queue) == 0)
+		nthreads++;
+
+	udev_input_open_worker(&queue);
+
+	while (nthreads > 0)
+		pthread_join(threads[--nthreads], NULL);
+
+	pthread_mutex_destroy(&queue.lock);
+}
+
 static int
 udev_input_add_devices(struct udev_input *input, struct udev *udev)
 {
 	struct udev_enumerate *e;
 	struct udev_list_entry *entry;
 	struct udev_device *device;
-	const char *path, *sysname;
+	struct udev_input_pending *pending = NULL, *new_pending;
+	size_t count = 0, len = 0, i;
+	unsigned int max_threads = input->max_open_threads;
+	const char *path, *sysname, *devnode;
+	int rc = 0;
 
 	e = udev_enumerate_new(udev);
 	udev_enumerate_add_match_subsystem(e, "input");
@@ -147,22 +271,62 @@ udev_input_add_devices(struct udev_input *input, struct udev *udev)
 		device = udev_device_new_from_syspath(udev, path);
 
 		sysname = udev_device_get_sysname(device);
-		if (strncmp("event", sysname, 5) != 0) {
+		devnode = udev_device_get_devnode(device);
+		if (strncmp("event", sysname, 5) != 0 || !devnode ||
+		    !device_in_seat(device, input) ||
+		    !device_is_handled(device)) {
 			udev_device_unref(device);
 			continue;
 		}
 
-		if (device_added(device, input) < 0) {
+		if (count == len) {
+			len = len ? len * 2 : 16;
+			new_pending = realloc(pending, len * sizeof *pending);
+			if (!new_pending) {
+				udev_device_unref(device);
+				rc = -1;
+				break;
+			}
+			pending = new_pending;
+		}
+
+		pending[count].devnode = strdup(devnode);
+		if (!pending[count].devnode) {
 			udev_device_unref(device);
-			udev_enumerate_unref(e);
-			return -1;
+			rc = -1;
+			break;
+		}
+		pending[count].udev_device = device;
+		pending[count].fd = -1;
+		count++;
+	}
+	udev_enumerate_unref(e);
+
+	if (rc == 0 && max_threads > 1)
+		udev_input_open_devices(input, pending, count, max_threads);
+
+	/* Devices are added in enumeration order, regardless of the order
+	 * they were opened in. */
+	for (i = 0; i < count; i++) {
+		device = pending[i].udev_device;
+
+		if (rc == 0) {
+			if (max_threads > 1)
+				rc = device_added_fd(device, input,
+						     pending[i].fd,
+						     &pending[i].bits);
+			else
+				rc = device_added(device, input);
+		} else if (max_threads > 1 && pending[i].fd >= 0) {
+			close_restricted(&input->base, pending[i].fd);
 		}
 
 		udev_device_unref(device);
+		free(pending[i].devnode);
 	}
-	udev_enumerate_unref(e);
+	free(pending);
 
-	return 0;
+	return rc;
 }
 
 static void
@@ -353,11 +517,36 @@ static const struct libinput_interface_backend interface_backend = {
 	.destroy = udev_input_destroy,
 };
 
+LIBINPUT_EXPORT int
+libinput_udev_set_max_open_threads(struct libinput *libinput,
+				   unsigned int max_threads)
+{
+	struct udev_input *input = (struct udev_input*)libinput;
+
+	if (libinput->interface_backend != &interface_backend)
+		return -1;
+
+	input->max_open_threads = max_threads;
+
+	return 0;
+}
+
 LIBINPUT_EXPORT struct libinput *
 libinput_create_from_udev(const struct libinput_interface *interface,
 			  void *user_data,
 			  struct udev *udev,
 			  const char *seat_id)
+{
+	return libinput_create_from_udev_threaded(interface, user_data,
+						  udev, seat_id, 0);
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_create_from_udev_threaded(const struct libinput_interface *interface,
+				   void *user_data,
+				   struct udev *udev,
+				   const char *seat_id,
+				   unsigned int max_open_threads)
 {
 	struct udev_input *input;
 
@@ -376,6 +565,7 @@ libinput_create_from_udev(const struct libinput_interface *interface,
 
 	input->udev = udev_ref(udev);
 	input->seat_id = strdup(seat_id);
+	input->max_open_threads = max_open_threads;
 
 	if (udev_input_enable(&input->base) < 0) {
 		udev_unref(udev);
@@ -38,6 +38,7 @@ struct udev_input {
 	struct udev_monitor *udev_monitor;
 	struct libinput_source *udev_monitor_source;
 	char *seat_id;
+	unsigned int max_open_threads;
 };
 
 #endif
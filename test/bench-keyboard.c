@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * A burst of key events, e.g. from a barcode scanner, processed by the
+ * keyboard dispatcher and consumed as it comes in, with and without the
+ * key event pool.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/input.h>
+
+#include "libinput-private.h"
+#include "bench.h"
+
+#define BURST_KEYS 32
+
+struct bench_keyboard {
+	struct evdev_device *device;
+	struct libinput *libinput;
+	struct input_event burst[BURST_KEYS * 2];
+	int drop_pool;
+};
+
+static void
+init_burst(struct bench_keyboard *bench)
+{
+	struct input_event *e = bench->burst;
+	int i;
+
+	memset(bench->burst, 0, sizeof bench->burst);
+	for (i = 0; i < BURST_KEYS; i++) {
+		e->type = EV_KEY;
+		e->code = KEY_A + i / 2;
+		e->value = !(i % 2);
+		e++;
+		e->type = EV_SYN;
+		e->code = SYN_REPORT;
+		e++;
+	}
+}
+
+static void
+bench_burst(void *data, unsigned int iterations)
+{
+	struct bench_keyboard *bench = data;
+	struct libinput *li = bench->libinput;
+	struct libinput_event *event;
+	unsigned int i;
+
+	for (i = 0; i < iterations; i += BURST_KEYS) {
+		evdev_process_events(bench->device, bench->burst,
+				     ARRAY_LENGTH(bench->burst));
+
+		while ((event = libinput_get_event(li)))
+			libinput_event_destroy(event);
+
+		/* Without the pool every event is allocated. */
+		while (bench->drop_pool && li->key_event_pool_count > 0)
+			free(li->key_event_pool[--li->key_event_pool_count]);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	struct litest_device *dev;
+	struct bench_keyboard bench;
+
+	dev = litest_create_device(LITEST_KEYBOARD);
+	bench.libinput = dev->libinput;
+	bench.device = bench_device_init(dev);
+	if (!bench.device)
+		return 1;
+	init_burst(&bench);
+
+	bench.drop_pool = 0;
+	bench_run("key event burst: pooled",
+		  bench_burst, &bench, BURST_KEYS * 1024, "event");
+	bench.drop_pool = 1;
+	bench_run("key event burst: allocated",
+		  bench_burst, &bench, BURST_KEYS * 1024, "event");
+
+	litest_delete_device(dev);
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Protocol A to protocol B conversion of a stream of frames with a
+ * varying number of moving contacts, by evdev_mt_a_convert() and, if
+ * available, by mtdev.
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <linux/input.h>
+
+#ifdef HAVE_MTDEV
+#include <mtdev.h>
+#include <mtdev-plumbing.h>
+#endif
+
+#include "evdev.h"
+#include "bench.h"
+
+#define FRAMES 1024
+#define MAX_CONTACTS 10
+#define EVENTS_PER_CONTACT 3
+
+struct frame {
+	struct input_event events[MAX_CONTACTS * EVENTS_PER_CONTACT + 1];
+	int count;
+};
+
+static struct frame frames[FRAMES];
+
+static void
+frame_add(struct frame *frame, uint16_t type, uint16_t code, int32_t value)
+{
+	struct input_event *e = &frame->events[frame->count++];
+
+	e->type = type;
+	e->code = code;
+	e->value = value;
+}
+
+/* Contacts circle around the center of the device. One to ten of them
+ * are down, changing every 64 frames. */
+static void
+generate_frames(void)
+{
+	struct frame *frame;
+	double angle;
+	int i, j, ncontacts;
+
+	for (i = 0; i < FRAMES; i++) {
+		frame = &frames[i];
+		ncontacts = 1 + (i / 64) % MAX_CONTACTS;
+
+		for (j = 0; j < ncontacts; j++) {
+			angle = i * 0.02 + j * 2 * M_PI / MAX_CONTACTS;
+			frame_add(frame, EV_ABS, ABS_MT_POSITION_X,
+				  2000 + (100 + j * 150) * cos(angle));
+			frame_add(frame, EV_ABS, ABS_MT_POSITION_Y,
+				  2000 + (100 + j * 150) * sin(angle));
+			frame_add(frame, EV_SYN, SYN_MT_REPORT, 0);
+		}
+		frame_add(frame, EV_SYN, SYN_REPORT, 0);
+	}
+}
+
+static void
+bench_mt_a(void *data, unsigned int iterations)
+{
+	struct evdev_mt_a *mt_a = data;
+	struct input_event *converted;
+	struct frame *frame;
+	unsigned int i;
+	int j;
+	volatile int count = 0;
+
+	for (i = 0; i < iterations; i++) {
+		frame = &frames[i % FRAMES];
+		for (j = 0; j < frame->count; j++)
+			count += evdev_mt_a_convert(mt_a,
+						    &frame->events[j],
+						    &converted);
+	}
+}
+
+#ifdef HAVE_MTDEV
+static void
+bench_mtdev(void *data, unsigned int iterations)
+{
+	struct mtdev *mtdev = data;
+	struct input_event converted;
+	struct frame *frame;
+	unsigned int i;
+	int j;
+	volatile int count = 0;
+
+	for (i = 0; i < iterations; i++) {
+		frame = &frames[i % FRAMES];
+		for (j = 0; j < frame->count; j++)
+			mtdev_put_event(mtdev, &frame->events[j]);
+		while (!mtdev_empty(mtdev)) {
+			mtdev_get_event(mtdev, &converted);
+			count++;
+		}
+	}
+}
+
+static struct mtdev *
+create_mtdev(void)
+{
+	struct mtdev *mtdev;
+
+	mtdev = mtdev_new();
+	if (!mtdev || mtdev_init(mtdev) != 0)
+		return NULL;
+
+	mtdev->caps.has_mtdata = 1;
+	mtdev_set_mt_event(mtdev, ABS_MT_POSITION_X, 1);
+	mtdev_set_abs_maximum(mtdev, ABS_MT_POSITION_X, 4000);
+	mtdev_set_mt_event(mtdev, ABS_MT_POSITION_Y, 1);
+	mtdev_set_abs_maximum(mtdev, ABS_MT_POSITION_Y, 4000);
+
+	return mtdev;
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+	struct evdev_mt_a *mt_a;
+#ifdef HAVE_MTDEV
+	struct mtdev *mtdev;
+#endif
+
+	generate_frames();
+
+	mt_a = evdev_mt_a_create();
+	if (!mt_a)
+		return 1;
+	bench_run("protocol A conversion: evdev_mt_a_convert",
+		  bench_mt_a, mt_a, FRAMES * 64, "frame");
+	evdev_mt_a_destroy(mt_a);
+
+#ifdef HAVE_MTDEV
+	mtdev = create_mtdev();
+	if (!mtdev)
+		return 1;
+	bench_run("protocol A conversion: mtdev",
+		  bench_mtdev, mtdev, FRAMES * 64, "frame");
+	mtdev_close_delete(mtdev);
+#else
+	printf("mtdev not available, skipping the comparison\n");
+#endif
+
+	return 0;
+}
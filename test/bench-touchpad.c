@@ -0,0 +1,280 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Frames of one finger moving and of two fingers scrolling on a
+ * clickpad, processed by the touchpad dispatcher, and the motion lost to
+ * the fixed point precision of the events over a stroke.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/input.h>
+
+#include "bench.h"
+#include "touchpad-quirks.h"
+
+/* Frames per stroke, including the touch down and lift frames. */
+#define STROKE_FRAMES 64
+#define FRAME_INTERVAL_US 12500
+#define MAX_FRAME_EVENTS 24
+
+/* Motion per frame (device units) of the timed strokes. */
+#define STEP 20
+
+/* The loss is measured with tuning that makes the motion pipeline
+ * linear: no hysteresis, and a constant acceleration factor small enough
+ * for the motion filter not to soften the deltas. Each frame of a
+ * constant speed stroke then moves by exactly LOSS_STEP * LOSS_FACTOR,
+ * which isn't a multiple of the 1/256 precision of the events. */
+#define LOSS_STEP 3
+#define LOSS_FACTOR 0.16
+
+static const char loss_quirks[] =
+	"[Bench]\n"
+	"Vendor=0x0002\n"
+	"Product=0x0011\n"
+	"HysteresisMarginDenominator=1000000\n"
+	"MinAccelFactor=0.16\n"
+	"MaxAccelFactor=0.16\n";
+
+struct bench_touchpad {
+	struct evdev_device *device;
+	struct libinput *libinput;
+	int fingers;
+	int step;
+	unsigned int frame;
+	uint64_t time_us;
+	int tracking_id;
+};
+
+static void
+frame_add(struct input_event *ev, int *count,
+	  uint16_t type, uint16_t code, int32_t value)
+{
+	ev[*count].type = type;
+	ev[*count].code = code;
+	ev[*count].value = value;
+	(*count)++;
+}
+
+/* One finger moves right, two fingers move down. */
+static int
+build_frame(struct bench_touchpad *bench, struct input_event *ev)
+{
+	unsigned int pos = bench->frame % STROKE_FRAMES;
+	int count = 0;
+	int i, slot, x, y;
+
+	memset(ev, 0, MAX_FRAME_EVENTS * sizeof *ev);
+
+	for (slot = 0; slot < bench->fingers; slot++) {
+		if (bench->fingers == 1) {
+			x = 2000 + pos * bench->step;
+			y = 2500;
+		} else {
+			x = 2500 + slot * 1000;
+			y = 1800 + pos * bench->step;
+		}
+
+		frame_add(ev, &count, EV_ABS, ABS_MT_SLOT, slot);
+		if (pos == STROKE_FRAMES - 1) {
+			frame_add(ev, &count, EV_ABS, ABS_MT_TRACKING_ID, -1);
+			continue;
+		}
+		if (pos == 0)
+			frame_add(ev, &count, EV_ABS, ABS_MT_TRACKING_ID,
+				  ++bench->tracking_id);
+		frame_add(ev, &count, EV_ABS, ABS_MT_POSITION_X, x);
+		frame_add(ev, &count, EV_ABS, ABS_MT_POSITION_Y, y);
+		if (slot == 0) {
+			frame_add(ev, &count, EV_ABS, ABS_X, x);
+			frame_add(ev, &count, EV_ABS, ABS_Y, y);
+		}
+	}
+
+	if (pos == 0 || pos == STROKE_FRAMES - 1) {
+		frame_add(ev, &count, EV_ABS, ABS_PRESSURE, pos ? 0 : 50);
+		frame_add(ev, &count, EV_KEY, BTN_TOUCH, !pos);
+		frame_add(ev, &count, EV_KEY,
+			  bench->fingers == 1 ?
+				BTN_TOOL_FINGER : BTN_TOOL_DOUBLETAP,
+			  !pos);
+	}
+	frame_add(ev, &count, EV_SYN, SYN_REPORT, 0);
+
+	for (i = 0; i < count; i++) {
+		ev[i].time.tv_sec = bench->time_us / 1000000;
+		ev[i].time.tv_usec = bench->time_us % 1000000;
+	}
+
+	bench->frame++;
+	bench->time_us += FRAME_INTERVAL_US;
+
+	return count;
+}
+
+static void
+bench_frames(void *data, unsigned int iterations)
+{
+	struct bench_touchpad *bench = data;
+	struct input_event ev[MAX_FRAME_EVENTS];
+	struct libinput_event *event;
+	unsigned int i;
+	int count;
+
+	for (i = 0; i < iterations; i++) {
+		count = build_frame(bench, ev);
+		evdev_process_events(bench->device, ev, count);
+
+		while ((event = libinput_get_event(bench->libinput)))
+			libinput_event_destroy(event);
+	}
+}
+
+/* The motion of one stroke that is missing from the events, in
+ * normalized units. Only the frames that emitted an event count, as the
+ * first frame after a touch down just starts the motion history. */
+static double
+stroke_loss(struct bench_touchpad *bench, int fingers)
+{
+	struct input_event ev[MAX_FRAME_EVENTS];
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	double emitted = 0.0, frame_emitted;
+	unsigned int i, moved = 0;
+	int count;
+
+	bench->fingers = fingers;
+
+	for (i = 0; i < STROKE_FRAMES; i++) {
+		count = build_frame(bench, ev);
+		evdev_process_events(bench->device, ev, count);
+
+		frame_emitted = 0.0;
+		while ((event = libinput_get_event(bench->libinput))) {
+			ptrev = libinput_event_get_pointer_event(event);
+			switch (libinput_event_get_type(event)) {
+			case LIBINPUT_EVENT_POINTER_MOTION:
+				frame_emitted += li_fixed_to_double(
+					libinput_event_pointer_get_dx(ptrev));
+				break;
+			case LIBINPUT_EVENT_POINTER_SCROLL:
+				frame_emitted += li_fixed_to_double(
+					libinput_event_pointer_get_scroll_value(
+					      ptrev,
+					      LIBINPUT_POINTER_AXIS_VERTICAL_SCROLL));
+				break;
+			default:
+				break;
+			}
+			libinput_event_destroy(event);
+		}
+
+		if (frame_emitted != 0.0)
+			moved++;
+		emitted += frame_emitted;
+	}
+
+	return moved * LOSS_STEP * LOSS_FACTOR - emitted;
+}
+
+static struct litest_device *
+create_loss_device(void)
+{
+	struct litest_device *dev;
+	char path[] = "/tmp/bench-quirks-XXXXXX";
+	FILE *file;
+	int fd;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		return NULL;
+	file = fdopen(fd, "w");
+	if (!file) {
+		close(fd);
+		unlink(path);
+		return NULL;
+	}
+	fputs(loss_quirks, file);
+	fclose(file);
+
+	/* The quirks are read when the context of the device is created. */
+	setenv(TOUCHPAD_QUIRKS_FILE_ENV, path, 1);
+	dev = litest_create_device(LITEST_SYNAPTICS_CLICKPAD);
+	unsetenv(TOUCHPAD_QUIRKS_FILE_ENV);
+	unlink(path);
+
+	return dev;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct litest_device *dev;
+	struct bench_touchpad bench;
+
+	memset(&bench, 0, sizeof bench);
+
+	dev = litest_create_device(LITEST_SYNAPTICS_CLICKPAD);
+	bench.libinput = dev->libinput;
+	bench.device = bench_device_init(dev);
+	if (!bench.device)
+		return 1;
+	bench.time_us = 1000000;
+	bench.step = STEP;
+
+	bench.fingers = 1;
+	bench_run("touchpad frames: one finger motion",
+		  bench_frames, &bench, STROKE_FRAMES * 256, "frame");
+	bench.fingers = 2;
+	bench_run("touchpad frames: two finger scroll",
+		  bench_frames, &bench, STROKE_FRAMES * 256, "frame");
+
+	litest_delete_device(dev);
+
+	memset(&bench, 0, sizeof bench);
+
+	dev = create_loss_device();
+	if (!dev)
+		return 1;
+	bench.libinput = dev->libinput;
+	bench.device = bench_device_init(dev);
+	if (!bench.device)
+		return 1;
+	bench.time_us = 1000000;
+	bench.step = LOSS_STEP;
+
+	bench_report("remainder loss: one finger motion",
+		     stroke_loss(&bench, 1), "units/stroke");
+	bench_report("remainder loss: two finger scroll",
+		     stroke_loss(&bench, 2), "units/stroke");
+
+	litest_delete_device(dev);
+
+	return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "bench.h"
+
+/* The first batch warms up caches and is not counted. */
+#define BENCH_BATCHES 6
+
+static uint64_t
+bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Time stamp counter cycles, which tick at a constant rate rather than
+ * with the frequency the core runs at. 0 if there is no such counter. */
+static uint64_t
+bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	return 0;
+#endif
+}
+
+double
+bench_run(const char *name,
+	  bench_func func,
+	  void *data,
+	  unsigned int iterations,
+	  const char *unit)
+{
+	uint64_t start, start_cycles, elapsed, cycles;
+	uint64_t best = UINT64_MAX, best_cycles = 0;
+	double ns;
+	int i;
+
+	for (i = 0; i < BENCH_BATCHES; i++) {
+		start = bench_now_ns();
+		start_cycles = bench_cycles();
+		func(data, iterations);
+		cycles = bench_cycles() - start_cycles;
+		elapsed = bench_now_ns() - start;
+
+		if (i > 0 && elapsed < best) {
+			best = elapsed;
+			best_cycles = cycles;
+		}
+	}
+
+	ns = (double) best / iterations;
+	if (best_cycles)
+		printf("%-48s %12.1f ns/%s %10.0f cycles/%s\n",
+		       name, ns, unit, (double) best_cycles / iterations, unit);
+	else
+		printf("%-48s %12.1f ns/%s\n", name, ns, unit);
+
+	return ns;
+}
+
+void
+bench_report(const char *name, double value, const char *unit)
+{
+	printf("%-48s %12.4f %s\n", name, value, unit);
+}
+
+struct evdev_device *
+bench_device_init(struct litest_device *dev)
+{
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct evdev_device *device = NULL;
+
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_DEVICE_ADDED)
+			device = (struct evdev_device *)
+				libinput_event_get_device(event);
+		libinput_event_destroy(event);
+	}
+
+	/* The dispatcher is otherwise only set up once the device sends
+	 * events, and none are read from it here. */
+	if (!device ||
+	    (!device->dispatch && evdev_device_init_dispatch(device) != 0))
+		return NULL;
+
+	return device;
+}
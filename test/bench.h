@@ -0,0 +1,57 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "evdev.h"
+#include "litest.h"
+
+/* A minimal timing harness for the benchmark programs, which are built
+ * with the tests but only run by "make bench". */
+
+/* Run the given number of iterations of the benchmarked code. */
+typedef void (*bench_func)(void *data, unsigned int iterations);
+
+/* Time batches of iterations of func and print the time per iteration
+ * of the fastest batch, which is the one least disturbed by the rest of
+ * the system, and its time stamp counter cycles per iteration where the
+ * CPU has one. unit names what one iteration is, e.g. "frame". Returns
+ * the time per iteration in nanoseconds. */
+double
+bench_run(const char *name,
+	  bench_func func,
+	  void *data,
+	  unsigned int iterations,
+	  const char *unit);
+
+/* Print a value measured by the benchmark itself, e.g. an error. */
+void
+bench_report(const char *name, double value, const char *unit);
+
+/* Set up the libinput device of a test device, so that events can be
+ * fed to it with evdev_process_events() without going through the
+ * kernel. Returns NULL on failure. */
+struct evdev_device *
+bench_device_init(struct litest_device *dev);
+
+#endif /* BENCH_H */
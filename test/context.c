@@ -0,0 +1,118 @@
+/*
+ * Copyright © 2013 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <check.h>
+#include <libinput.h>
+#include <stdint.h>
+
+#include "litest.h"
+
+static void
+queue_threshold_reached(struct libinput *li, size_t depth, void *data)
+{
+	int *called = data;
+
+	ck_assert_int_eq(depth, 2);
+	(*called)++;
+}
+
+START_TEST(context_queue_stats)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	uint64_t posted, consumed;
+	int called = 0;
+	int i;
+
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_get_queue_depth(li), 0);
+	libinput_reset_queue_high_water_mark(li);
+	ck_assert_int_eq(libinput_get_queue_high_water_mark(li), 0);
+
+	posted = libinput_get_events_posted(li);
+	consumed = libinput_get_events_consumed(li);
+	libinput_set_queue_threshold(li, 2, queue_threshold_reached, &called);
+
+	for (i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(libinput_get_queue_depth(li), 3);
+	ck_assert_int_eq(libinput_get_queue_high_water_mark(li), 3);
+	ck_assert_int_eq(libinput_get_events_posted(li) - posted, 3);
+	ck_assert_int_eq(called, 1);
+
+	event = libinput_get_event(li);
+	libinput_event_destroy(event);
+	ck_assert_int_eq(libinput_get_queue_depth(li), 2);
+	ck_assert_int_eq(libinput_get_queue_high_water_mark(li), 3);
+	ck_assert_int_eq(libinput_get_events_consumed(li) - consumed, 1);
+
+	libinput_set_queue_threshold(li, 0, NULL, NULL);
+	litest_drain_events(li);
+}
+END_TEST
+
+static void
+queue_threshold_count(struct libinput *li, size_t depth, void *data)
+{
+	int *called = data;
+
+	(*called)++;
+}
+
+START_TEST(context_queue_threshold_resume)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	int called = 0;
+
+	litest_drain_events(li);
+	libinput_set_queue_threshold(li, 1, queue_threshold_count, &called);
+
+	/* device removed and added events are queued outside of
+	 * libinput_dispatch() */
+	libinput_suspend(li);
+	ck_assert_int_eq(called, 1);
+	litest_drain_events(li);
+
+	called = 0;
+	ck_assert_int_eq(libinput_resume(li), 0);
+	ck_assert_int_eq(called, 1);
+
+	libinput_set_queue_threshold(li, 0, NULL, NULL);
+	litest_drain_events(li);
+}
+END_TEST
+
+int main (int argc, char **argv) {
+
+	litest_add("context:queue", context_queue_stats, LITEST_POINTER, LITEST_ANY);
+	litest_add("context:queue", context_queue_threshold_resume, LITEST_ANY, LITEST_ANY);
+
+	return litest_run(argc, argv);
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <check.h>
+#include <fcntl.h>
+#include <libinput.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "libinput-util.h"
+#include "litest.h"
+
+#define KEYS_BITS_PER_LONG (sizeof(unsigned long) * CHAR_BIT)
+
+static int
+key_is_down(struct libinput_device *device, unsigned int key)
+{
+	unsigned long keys[(KEY_CNT + KEYS_BITS_PER_LONG - 1) /
+			   KEYS_BITS_PER_LONG];
+
+	ck_assert_int_eq(libinput_device_get_keys(device,
+						  (char *) keys,
+						  sizeof keys),
+			 sizeof keys);
+
+	return (keys[key / KEYS_BITS_PER_LONG] >>
+		(key % KEYS_BITS_PER_LONG)) & 1;
+}
+
+static struct libinput_device *
+test_key_event(struct litest_device *dev,
+	       unsigned int key,
+	       int state,
+	       uint32_t seat_key_count)
+{
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_keyboard *kev;
+	struct libinput_device *device;
+
+	litest_event(dev, EV_KEY, key, state);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ck_assert(event != NULL);
+	ck_assert_int_eq(libinput_event_get_type(event),
+			 LIBINPUT_EVENT_KEYBOARD_KEY);
+
+	kev = libinput_event_get_keyboard_event(event);
+	ck_assert(kev != NULL);
+	ck_assert_int_eq(libinput_event_keyboard_get_key(kev), key);
+	ck_assert_int_eq(libinput_event_keyboard_get_seat_key_count(kev),
+			 seat_key_count);
+
+	device = libinput_event_get_device(event);
+	ck_assert_int_eq(key_is_down(device, key), state);
+
+	libinput_event_destroy(event);
+
+	return device;
+}
+
+START_TEST(keyboard_key_state)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device;
+
+	litest_drain_events(dev->libinput);
+
+	test_key_event(dev, KEY_A, 1, 1);
+	device = test_key_event(dev, KEY_B, 1, 1);
+	ck_assert_int_eq(key_is_down(device, KEY_A), 1);
+
+	test_key_event(dev, KEY_A, 0, 0);
+	ck_assert_int_eq(key_is_down(device, KEY_B), 1);
+	test_key_event(dev, KEY_B, 0, 0);
+}
+END_TEST
+
+static struct libinput_event *
+wait_for_event(struct libinput *li)
+{
+	struct pollfd fds;
+	struct libinput_event *event;
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	while (poll(&fds, 1, 1000) > 0) {
+		libinput_dispatch(li);
+		event = libinput_get_event(li);
+		if (event)
+			return event;
+	}
+
+	return NULL;
+}
+
+START_TEST(keyboard_key_repeat)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device;
+	struct libinput_event *event;
+	struct libinput_event_keyboard *kev;
+	unsigned int rep[2], rep_libinput[2];
+	int i, fd;
+
+	litest_drain_events(li);
+
+	fd = open(libevdev_uinput_get_devnode(dev->uinput), O_RDONLY);
+	ck_assert_int_ge(fd, 0);
+	ck_assert_int_eq(ioctl(fd, EVIOCGREP, rep), 0);
+
+	device = test_key_event(dev, KEY_A, 1, 1);
+	test_key_event(dev, KEY_A, 0, 0);
+	ck_assert_int_eq(libinput_device_keyboard_set_repeat(device, 10, 0),
+			 -1);
+	ck_assert_int_eq(libinput_device_keyboard_set_repeat(device, 20, 10),
+			 0);
+
+	/* the kernel repeat settings are shared and left alone */
+	ck_assert_int_eq(ioctl(fd, EVIOCGREP, rep_libinput), 0);
+	ck_assert_int_eq(rep_libinput[0], rep[0]);
+	ck_assert_int_eq(rep_libinput[1], rep[1]);
+	close(fd);
+
+	litest_event(dev, EV_KEY, KEY_A, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+
+	event = wait_for_event(li);
+	ck_assert(event != NULL);
+	kev = libinput_event_get_keyboard_event(event);
+	ck_assert(kev != NULL);
+	ck_assert_int_eq(libinput_event_keyboard_get_repeat(kev), 0);
+	libinput_event_destroy(event);
+
+	for (i = 0; i < 3; i++) {
+		event = wait_for_event(li);
+		ck_assert(event != NULL);
+		kev = libinput_event_get_keyboard_event(event);
+		ck_assert(kev != NULL);
+		ck_assert_int_eq(libinput_event_keyboard_get_key(kev), KEY_A);
+		ck_assert_int_eq(libinput_event_keyboard_get_key_state(kev),
+				 LIBINPUT_KEYBOARD_KEY_STATE_PRESSED);
+		ck_assert_int_ne(libinput_event_keyboard_get_repeat(kev), 0);
+		libinput_event_destroy(event);
+	}
+
+	litest_event(dev, EV_KEY, KEY_A, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_device_keyboard_set_repeat(device, 0, 0), 0);
+}
+END_TEST
+
+/* Read the next LED change the kernel passed on to the uinput device.
+ * Returns 0 if there was none. */
+static int
+read_led_change(struct litest_device *dev, unsigned int led, int *value)
+{
+	struct pollfd fds;
+	struct input_event ev;
+
+	fds.fd = libevdev_uinput_get_fd(dev->uinput);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	while (poll(&fds, 1, 100) > 0 &&
+	       read(fds.fd, &ev, sizeof ev) == sizeof ev) {
+		if (ev.type == EV_LED && ev.code == led) {
+			*value = ev.value;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void
+write_led(int fd, unsigned int led, int value)
+{
+	struct input_event ev[2];
+
+	memset(ev, 0, sizeof ev);
+	ev[0].type = EV_LED;
+	ev[0].code = led;
+	ev[0].value = value;
+	ev[1].type = EV_SYN;
+	ev[1].code = SYN_REPORT;
+
+	ck_assert_int_eq(write(fd, ev, sizeof ev), sizeof ev);
+}
+
+START_TEST(keyboard_led_update)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device;
+	int fd, value;
+
+	litest_drain_events(li);
+
+	device = test_key_event(dev, KEY_A, 1, 1);
+	test_key_event(dev, KEY_A, 0, 0);
+
+	libinput_device_led_update(device, LIBINPUT_LED_CAPS_LOCK);
+	ck_assert(read_led_change(dev, LED_CAPSL, &value));
+	ck_assert_int_eq(value, 1);
+
+	/* another client turns caps lock off behind libinput's back */
+	fd = open(libevdev_uinput_get_devnode(dev->uinput), O_RDWR);
+	ck_assert_int_ge(fd, 0);
+	write_led(fd, LED_CAPSL, 0);
+	close(fd);
+	ck_assert(read_led_change(dev, LED_CAPSL, &value));
+	ck_assert_int_eq(value, 0);
+	libinput_dispatch(li);
+
+	/* the change was reported to libinput as an event, so the same
+	 * update is written again */
+	libinput_device_led_update(device, LIBINPUT_LED_CAPS_LOCK);
+	ck_assert(read_led_change(dev, LED_CAPSL, &value));
+	ck_assert_int_eq(value, 1);
+
+	/* nothing changes if the LEDs already match */
+	libinput_device_led_update(device, LIBINPUT_LED_CAPS_LOCK);
+	ck_assert(!read_led_change(dev, LED_CAPSL, &value));
+
+	libinput_device_led_update(device, 0);
+	ck_assert(read_led_change(dev, LED_CAPSL, &value));
+	ck_assert_int_eq(value, 0);
+}
+END_TEST
+
+int main (int argc, char **argv) {
+
+	litest_add("keyboard:keys", keyboard_key_state, LITEST_KEYS, LITEST_ANY);
+	litest_add("keyboard:repeat", keyboard_key_repeat, LITEST_KEYS, LITEST_ANY);
+	litest_add("keyboard:leds", keyboard_led_update, LITEST_KEYS, LITEST_ANY);
+
+	return litest_run(argc, argv);
+}
@@ -124,6 +124,7 @@ litest_create_bcm5974(struct litest_device *d)
 	libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_DOUBLETAP, NULL);
 	libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_TRIPLETAP, NULL);
 	libevdev_enable_event_code(dev, EV_KEY, BTN_TOOL_QUADTAP, NULL);
+	libevdev_enable_property(dev, INPUT_PROP_BUTTONPAD);
 
 	ARRAY_FOR_EACH(abs, a)
 		libevdev_enable_event_code(dev, EV_ABS, a->value, a);
@@ -106,7 +106,7 @@ litest_create_keyboard(struct litest_device *d)
 
 struct litest_test_device litest_keyboard_device = {
 	.type = LITEST_KEYBOARD,
-	.features = LITEST_KEYBOARD,
+	.features = LITEST_KEYS,
 	.shortname = "default keyboard",
 	.setup = litest_keyboard_setup,
 	.teardown = litest_generic_device_teardown,
@@ -42,6 +42,7 @@
 #include "litest.h"
 #include "litest-int.h"
 #include "libinput-util.h"
+#include "touchpad-quirks.h"
 
 static int in_debugger = -1;
 
@@ -81,6 +82,9 @@ extern struct litest_test_device litest_trackpoint_device;
 extern struct litest_test_device litest_bcm5974_device;
 extern struct litest_test_device litest_mouse_device;
 extern struct litest_test_device litest_wacom_touch_device;
+extern struct litest_test_device litest_synaptics_touchpad_device;
+extern struct litest_test_device litest_touchpad_resolution_low_device;
+extern struct litest_test_device litest_touchpad_resolution_high_device;
 
 struct litest_test_device* devices[] = {
 	&litest_synaptics_clickpad_device,
@@ -89,6 +93,9 @@ struct litest_test_device* devices[] = {
 	&litest_bcm5974_device,
 	&litest_mouse_device,
 	&litest_wacom_touch_device,
+	&litest_synaptics_touchpad_device,
+	&litest_touchpad_resolution_low_device,
+	&litest_touchpad_resolution_high_device,
 	NULL,
 };
 
@@ -260,6 +267,10 @@ litest_run(int argc, char **argv) {
 			setenv("CK_FORK", "no", 0);
 	}
 
+	/* Use the touchpad quirks of the source tree, not the installed
+	 * ones. */
+	setenv(TOUCHPAD_QUIRKS_FILE_ENV, LITEST_TOUCHPAD_QUIRKS, 0);
+
 	list_for_each(s, &all_tests, node) {
 		if (!sr)
 			sr = srunner_create(s->suite);
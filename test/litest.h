@@ -41,6 +41,9 @@ enum litest_device_type {
 	LITEST_TRACKPOINT,
 	LITEST_MOUSE,
 	LITEST_WACOM_TOUCH,
+	LITEST_SYNAPTICS_TOUCHPAD,
+	LITEST_TOUCHPAD_RESOLUTION_LOW,
+	LITEST_TOUCHPAD_RESOLUTION_HIGH,
 };
 
 enum litest_device_feature {
@@ -0,0 +1,330 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <check.h>
+#include <linux/input.h>
+
+#include "evdev.h"
+#include "litest.h"
+
+/* The slot state a protocol B consumer builds from the converted
+ * events. */
+struct mt_b_state {
+	int slot;
+	struct {
+		int32_t tracking_id;
+		int32_t x, y;
+	} slots[MAX_SLOTS];
+};
+
+static void
+mt_b_state_init(struct mt_b_state *state)
+{
+	int i;
+
+	state->slot = 0;
+	for (i = 0; i < MAX_SLOTS; i++)
+		state->slots[i].tracking_id = -1;
+}
+
+static int
+mt_b_state_count(const struct mt_b_state *state)
+{
+	int i, n = 0;
+
+	for (i = 0; i < MAX_SLOTS; i++) {
+		if (state->slots[i].tracking_id != -1)
+			n++;
+	}
+
+	return n;
+}
+
+/* The slot of the contact at x/y, or -1 if there is none. */
+static int
+mt_b_state_find(const struct mt_b_state *state, int32_t x, int32_t y)
+{
+	int i;
+
+	for (i = 0; i < MAX_SLOTS; i++) {
+		if (state->slots[i].tracking_id != -1 &&
+		    state->slots[i].x == x &&
+		    state->slots[i].y == y)
+			return i;
+	}
+
+	return -1;
+}
+
+static void
+convert_event(struct evdev_mt_a *mt_a, struct mt_b_state *state,
+	      uint16_t type, uint16_t code, int32_t value)
+{
+	struct input_event e = { .type = type, .code = code, .value = value };
+	struct input_event *events;
+	int i, n;
+
+	n = evdev_mt_a_convert(mt_a, &e, &events);
+
+	for (i = 0; i < n; i++) {
+		if (events[i].type == EV_SYN) {
+			ck_assert_int_eq(events[i].code, SYN_REPORT);
+			ck_assert_int_eq(i, n - 1);
+			continue;
+		}
+
+		ck_assert_int_eq(events[i].type, EV_ABS);
+		switch (events[i].code) {
+		case ABS_MT_SLOT:
+			ck_assert_int_ge(events[i].value, 0);
+			ck_assert_int_lt(events[i].value, MAX_SLOTS);
+			state->slot = events[i].value;
+			break;
+		case ABS_MT_TRACKING_ID:
+			state->slots[state->slot].tracking_id =
+				events[i].value;
+			break;
+		case ABS_MT_POSITION_X:
+			ck_assert_int_ne(
+				state->slots[state->slot].tracking_id, -1);
+			state->slots[state->slot].x = events[i].value;
+			break;
+		case ABS_MT_POSITION_Y:
+			ck_assert_int_ne(
+				state->slots[state->slot].tracking_id, -1);
+			state->slots[state->slot].y = events[i].value;
+			break;
+		default:
+			ck_abort_msg("unexpected event code %d",
+				     events[i].code);
+		}
+	}
+}
+
+/* Report one protocol A frame with the given contacts, in order. */
+static void
+convert_frame(struct evdev_mt_a *mt_a, struct mt_b_state *state,
+	      const int32_t contacts[][2], int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		convert_event(mt_a, state,
+			      EV_ABS, ABS_MT_POSITION_X, contacts[i][0]);
+		convert_event(mt_a, state,
+			      EV_ABS, ABS_MT_POSITION_Y, contacts[i][1]);
+		convert_event(mt_a, state, EV_SYN, SYN_MT_REPORT, 0);
+	}
+	convert_event(mt_a, state, EV_SYN, SYN_REPORT, 0);
+}
+
+START_TEST(mt_a_passthrough)
+{
+	struct evdev_mt_a *mt_a = evdev_mt_a_create();
+	struct input_event e = { .type = EV_KEY,
+				 .code = BTN_TOUCH,
+				 .value = 1 };
+	struct input_event *events;
+
+	ck_assert(mt_a != NULL);
+
+	/* Events other than protocol A contacts are passed on as is. */
+	ck_assert_int_eq(evdev_mt_a_convert(mt_a, &e, &events), 1);
+	ck_assert(events == &e);
+
+	e.type = EV_ABS;
+	e.code = ABS_X;
+	ck_assert_int_eq(evdev_mt_a_convert(mt_a, &e, &events), 1);
+	ck_assert(events == &e);
+
+	/* Protocol A axes other than the position are dropped. */
+	e.code = ABS_MT_TOUCH_MAJOR;
+	ck_assert_int_eq(evdev_mt_a_convert(mt_a, &e, &events), 0);
+
+	evdev_mt_a_destroy(mt_a);
+}
+END_TEST
+
+START_TEST(mt_a_appear_disappear)
+{
+	struct evdev_mt_a *mt_a = evdev_mt_a_create();
+	struct mt_b_state state;
+	const int32_t one[][2] = { { 100, 200 } };
+	const int32_t two[][2] = { { 500, 600 }, { 101, 201 } };
+	const int32_t second[][2] = { { 505, 605 } };
+	int slot_a, slot_b;
+	int32_t id_b;
+
+	ck_assert(mt_a != NULL);
+	mt_b_state_init(&state);
+
+	convert_frame(mt_a, &state, one, 1);
+	ck_assert_int_eq(mt_b_state_count(&state), 1);
+	slot_a = mt_b_state_find(&state, 100, 200);
+	ck_assert_int_ne(slot_a, -1);
+
+	/* A new contact gets a new slot, the existing one keeps its slot
+	 * although it is now reported second. */
+	convert_frame(mt_a, &state, two, 2);
+	ck_assert_int_eq(mt_b_state_count(&state), 2);
+	ck_assert_int_eq(mt_b_state_find(&state, 101, 201), slot_a);
+	slot_b = mt_b_state_find(&state, 500, 600);
+	ck_assert_int_ne(slot_b, -1);
+	ck_assert_int_ne(slot_b, slot_a);
+	id_b = state.slots[slot_b].tracking_id;
+	ck_assert_int_ne(id_b, state.slots[slot_a].tracking_id);
+
+	/* The contact that is gone is released, the other one continues. */
+	convert_frame(mt_a, &state, second, 1);
+	ck_assert_int_eq(mt_b_state_count(&state), 1);
+	ck_assert_int_eq(state.slots[slot_a].tracking_id, -1);
+	ck_assert_int_eq(mt_b_state_find(&state, 505, 605), slot_b);
+	ck_assert_int_eq(state.slots[slot_b].tracking_id, id_b);
+
+	/* An empty frame releases all contacts. */
+	convert_frame(mt_a, &state, NULL, 0);
+	ck_assert_int_eq(mt_b_state_count(&state), 0);
+
+	/* A contact after all were lifted is a new touch. */
+	convert_frame(mt_a, &state, second, 1);
+	ck_assert_int_eq(mt_b_state_count(&state), 1);
+	slot_b = mt_b_state_find(&state, 505, 605);
+	ck_assert_int_ne(state.slots[slot_b].tracking_id, id_b);
+
+	evdev_mt_a_destroy(mt_a);
+}
+END_TEST
+
+START_TEST(mt_a_crossing)
+{
+	struct evdev_mt_a *mt_a = evdev_mt_a_create();
+	struct mt_b_state state;
+	int32_t contacts[2][2];
+	int32_t id_a = -1, id_b = -1;
+	int slot_a, slot_b;
+	int i;
+
+	ck_assert(mt_a != NULL);
+	mt_b_state_init(&state);
+
+	/* One contact moves right along y = 1000, the other one down along
+	 * x = 1000, so their paths cross, the second contact passing the
+	 * crossing shortly before the first one. The order the contacts are
+	 * reported in alternates, as protocol A doesn't define it. */
+	for (i = 0; i <= 40; i++) {
+		contacts[i % 2][0] = 800 + i * 10;
+		contacts[i % 2][1] = 1000;
+		contacts[(i + 1) % 2][0] = 1000;
+		contacts[(i + 1) % 2][1] = 700 + i * 20;
+		convert_frame(mt_a, &state, contacts, 2);
+
+		ck_assert_int_eq(mt_b_state_count(&state), 2);
+		slot_a = mt_b_state_find(&state, 800 + i * 10, 1000);
+		slot_b = mt_b_state_find(&state, 1000, 700 + i * 20);
+		ck_assert_int_ne(slot_a, -1);
+		ck_assert_int_ne(slot_b, -1);
+
+		if (i == 0) {
+			id_a = state.slots[slot_a].tracking_id;
+			id_b = state.slots[slot_b].tracking_id;
+		}
+
+		ck_assert_int_eq(state.slots[slot_a].tracking_id, id_a);
+		ck_assert_int_eq(state.slots[slot_b].tracking_id, id_b);
+	}
+
+	evdev_mt_a_destroy(mt_a);
+}
+END_TEST
+
+START_TEST(mt_a_max_slots)
+{
+	struct evdev_mt_a *mt_a = evdev_mt_a_create();
+	struct mt_b_state state;
+	int32_t contacts[MAX_SLOTS + 4][2];
+	int32_t reversed[MAX_SLOTS][2];
+	int32_t ids[MAX_SLOTS];
+	int i, slot, released;
+
+	ck_assert(mt_a != NULL);
+	mt_b_state_init(&state);
+
+	for (i = 0; i < MAX_SLOTS + 4; i++) {
+		contacts[i][0] = i * 100;
+		contacts[i][1] = i * 100;
+	}
+
+	/* Contacts beyond the number of slots are dropped. */
+	convert_frame(mt_a, &state, contacts, MAX_SLOTS + 4);
+	ck_assert_int_eq(mt_b_state_count(&state), MAX_SLOTS);
+	for (i = 0; i < MAX_SLOTS; i++) {
+		slot = mt_b_state_find(&state, i * 100, i * 100);
+		ck_assert_int_ne(slot, -1);
+		ids[i] = state.slots[slot].tracking_id;
+	}
+
+	/* With all slots in use, every contact keeps its slot regardless
+	 * of the order it is reported in. */
+	for (i = 0; i < MAX_SLOTS; i++) {
+		contacts[i][0] += 5;
+		reversed[MAX_SLOTS - 1 - i][0] = contacts[i][0];
+		reversed[MAX_SLOTS - 1 - i][1] = contacts[i][1];
+	}
+	convert_frame(mt_a, &state, reversed, MAX_SLOTS);
+	ck_assert_int_eq(mt_b_state_count(&state), MAX_SLOTS);
+	for (i = 0; i < MAX_SLOTS; i++) {
+		slot = mt_b_state_find(&state, contacts[i][0], contacts[i][1]);
+		ck_assert_int_ne(slot, -1);
+		ck_assert_int_eq(state.slots[slot].tracking_id, ids[i]);
+	}
+
+	/* A lifted contact frees its slot for a new one. */
+	released = mt_b_state_find(&state, contacts[3][0], contacts[3][1]);
+	contacts[3][0] = contacts[MAX_SLOTS - 1][0];
+	contacts[3][1] = contacts[MAX_SLOTS - 1][1];
+	convert_frame(mt_a, &state, contacts, MAX_SLOTS - 1);
+	ck_assert_int_eq(mt_b_state_count(&state), MAX_SLOTS - 1);
+	ck_assert_int_eq(state.slots[released].tracking_id, -1);
+
+	contacts[MAX_SLOTS - 1][0] = 5000;
+	contacts[MAX_SLOTS - 1][1] = 7000;
+	convert_frame(mt_a, &state, contacts, MAX_SLOTS + 4);
+	ck_assert_int_eq(mt_b_state_count(&state), MAX_SLOTS);
+	ck_assert_int_eq(mt_b_state_find(&state, 5000, 7000), released);
+	for (i = 0; i < MAX_SLOTS; i++)
+		ck_assert_int_ne(state.slots[released].tracking_id, ids[i]);
+
+	evdev_mt_a_destroy(mt_a);
+}
+END_TEST
+
+int main(int argc, char **argv) {
+
+	litest_add_no_device("mt-a:convert", mt_a_passthrough);
+	litest_add_no_device("mt-a:convert", mt_a_appear_disappear);
+	litest_add_no_device("mt-a:match", mt_a_crossing);
+	litest_add_no_device("mt-a:match", mt_a_max_slots);
+
+	return litest_run(argc, argv);
+}
@@ -129,6 +129,16 @@ START_TEST(path_create_destroy)
 }
 END_TEST
 
+START_TEST(path_set_max_open_threads)
+{
+	struct litest_device *dev = litest_current_device();
+
+	/* only udev contexts enumerate devices */
+	ck_assert_int_eq(libinput_udev_set_max_open_threads(dev->libinput, 4),
+			 -1);
+}
+END_TEST
+
 START_TEST(path_added_seat)
 {
 	struct litest_device *dev = litest_current_device();
@@ -299,6 +309,7 @@ int main (int argc, char **argv) {
 	litest_add("path:create", path_create_NULL, LITEST_ANY, LITEST_ANY);
 	litest_add("path:create", path_create_invalid, LITEST_ANY, LITEST_ANY);
 	litest_add("path:create", path_create_destroy, LITEST_ANY, LITEST_ANY);
+	litest_add("path:create", path_set_max_open_threads, LITEST_ANY, LITEST_ANY);
 	litest_add("path:suspend", path_suspend, LITEST_ANY, LITEST_ANY);
 	litest_add("path:suspend", path_double_suspend, LITEST_ANY, LITEST_ANY);
 	litest_add("path:suspend", path_double_resume, LITEST_ANY, LITEST_ANY);
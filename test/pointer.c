@@ -53,6 +53,12 @@ test_relative_event(struct litest_device *dev, int dx, int dy)
 	ck_assert_int_eq(libinput_event_pointer_get_dx(ptrev), li_fixed_from_int(dx));
 	ck_assert_int_eq(libinput_event_pointer_get_dy(ptrev), li_fixed_from_int(dy));
 
+	/* Motion doesn't scroll, whatever its deltas. */
+	ck_assert_int_eq(libinput_event_pointer_get_scroll_value(ptrev,
+			 LIBINPUT_POINTER_AXIS_HORIZONTAL_SCROLL), 0);
+	ck_assert_int_eq(libinput_event_pointer_get_scroll_value(ptrev,
+			 LIBINPUT_POINTER_AXIS_VERTICAL_SCROLL), 0);
+
 	libinput_event_destroy(event);
 }
 
@@ -74,6 +80,58 @@ START_TEST(pointer_motion_relative)
 }
 END_TEST
 
+START_TEST(pointer_motion_rate_limit)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	int i;
+
+	litest_drain_events(li);
+
+	/* Send one event to get a hold of the device. */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ck_assert(event != NULL);
+	ck_assert_int_eq(libinput_device_pointer_set_max_motion_rate(
+					libinput_event_get_device(event), 1),
+			 0);
+	libinput_event_destroy(event);
+
+	/* With one event per second, all but the first motion is held back
+	 * and then added to the still queued first motion event once the
+	 * button forces it out. */
+	for (i = 0; i < 4; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_REL, REL_Y, -1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ck_assert(event != NULL);
+	ck_assert_int_eq(libinput_event_get_type(event), LIBINPUT_EVENT_POINTER_MOTION);
+	ptrev = libinput_event_get_pointer_event(event);
+	ck_assert_int_eq(libinput_event_pointer_get_dx(ptrev), li_fixed_from_int(4));
+	ck_assert_int_eq(libinput_event_pointer_get_dy(ptrev), li_fixed_from_int(-4));
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	ck_assert(event != NULL);
+	ck_assert_int_eq(libinput_event_get_type(event), LIBINPUT_EVENT_POINTER_BUTTON);
+	libinput_event_destroy(event);
+
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+}
+END_TEST
+
 static void
 test_button_event(struct litest_device *dev, int button, int state)
 {
@@ -186,6 +244,7 @@ END_TEST
 int main (int argc, char **argv) {
 
 	litest_add("pointer:motion", pointer_motion_relative, LITEST_POINTER, LITEST_ANY);
+	litest_add("pointer:motion", pointer_motion_rate_limit, LITEST_POINTER | LITEST_BUTTON, LITEST_ANY);
 	litest_add("pointer:button", pointer_button, LITEST_BUTTON, LITEST_ANY);
 	litest_add("pointer:scroll", pointer_scroll_wheel, LITEST_WHEEL, LITEST_ANY);
 
@@ -0,0 +1,1138 @@
+/*
+ * Copyright © 2014 Jonas Ådahl
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <check.h>
+#include <libevdev/libevdev.h>
+#include <libinput.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "evdev.h"
+#include "libinput-private.h"
+#include "libinput-util.h"
+#include "litest.h"
+#include "touchpad-quirks.h"
+
+START_TEST(touchpad_1fg_motion)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	int nmotion = 0;
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_move_to(dev, 0, 50, 50, 80, 50, 10);
+	litest_touch_up(dev, 0);
+
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_POINTER_MOTION) {
+			ptrev = libinput_event_get_pointer_event(event);
+			ck_assert_int_ge(libinput_event_pointer_get_dx(ptrev),
+					 0);
+			ck_assert_int_eq(libinput_event_pointer_get_dy(ptrev),
+					 0);
+			nmotion++;
+		}
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_gt(nmotion, 0);
+}
+END_TEST
+
+static void
+history_set(struct touchpad_motion *history, unsigned int index,
+	    uint32_t time, int32_t x)
+{
+	history[index].x = x;
+	history[index].y = 0;
+	history[index].time = time;
+}
+
+START_TEST(touchpad_estimate_delta)
+{
+	struct touchpad_motion history[TOUCHPAD_HISTORY_MAX];
+	li_fixed_t dx, dy;
+
+	memset(history, 0, sizeof(history));
+
+	/* Two samples give the last displacement. */
+	history_set(history, 0, 0, 0);
+	history_set(history, 1, 10, 1);
+	evdev_touchpad_estimate_delta(history, 1, 2, &dx, &dy);
+	ck_assert_int_eq(dx, li_fixed_from_int(1));
+	ck_assert_int_eq(dy, 0);
+
+	/* Constant speed is fitted exactly. */
+	history_set(history, 2, 20, 2);
+	evdev_touchpad_estimate_delta(history, 2, 3, &dx, &dy);
+	ck_assert_int_eq(dx, li_fixed_from_int(1));
+
+	/* The fit of an irregular interval is 161.68/256 and rounded to the
+	 * nearest fixed point value in both directions. */
+	history_set(history, 1, 10, 0);
+	history_set(history, 2, 25, 1);
+	evdev_touchpad_estimate_delta(history, 2, 3, &dx, &dy);
+	ck_assert_int_eq(dx, 162);
+	ck_assert_int_eq(dy, 0);
+
+	history_set(history, 2, 25, -1);
+	evdev_touchpad_estimate_delta(history, 2, 3, &dx, &dy);
+	ck_assert_int_eq(dx, -162);
+
+	/* The history is a ring. */
+	history_set(history, TOUCHPAD_HISTORY_MAX - 2, 0, 0);
+	history_set(history, TOUCHPAD_HISTORY_MAX - 1, 10, 0);
+	history_set(history, 0, 25, 1);
+	evdev_touchpad_estimate_delta(history, 0, 3, &dx, &dy);
+	ck_assert_int_eq(dx, 162);
+}
+END_TEST
+
+/* Point the quirks file variable to path, returning the previous value
+ * to restore with quirks_file_restore(). */
+static char *
+quirks_file_set(const char *path)
+{
+	char *saved = getenv(TOUCHPAD_QUIRKS_FILE_ENV);
+
+	if (saved)
+		saved = strdup(saved);
+	setenv(TOUCHPAD_QUIRKS_FILE_ENV, path, 1);
+
+	return saved;
+}
+
+static void
+quirks_file_restore(char *saved)
+{
+	if (saved) {
+		setenv(TOUCHPAD_QUIRKS_FILE_ENV, saved, 1);
+		free(saved);
+	} else {
+		unsetenv(TOUCHPAD_QUIRKS_FILE_ENV);
+	}
+}
+
+/* Read the quirks of the given file into a context that is only used
+ * for the lookup. */
+static void
+quirks_init(struct libinput *li, const char *path)
+{
+	char *saved = quirks_file_set(path);
+
+	memset(li, 0, sizeof *li);
+	touchpad_quirks_init(li);
+
+	quirks_file_restore(saved);
+}
+
+START_TEST(touchpad_quirks_file)
+{
+	struct libinput li;
+	const struct touchpad_quirks *quirks, *defaults;
+	char path[] = "/tmp/litest-quirks-XXXXXX";
+	FILE *file;
+	int fd, i;
+
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	file = fdopen(fd, "w");
+	ck_assert(file != NULL);
+
+	fprintf(file,
+		"# comment\n"
+		"[Exact]\n"
+		"Vendor=0x1234\n"
+		"Product=0x5678\n"
+		"Model=synaptics\n"
+		"TouchLow=1 0.5\n"
+		"HistoryLength=8\n"
+		"Resolution=40 30\n"
+		"\n"
+		"[Any product]\n"
+		"Vendor = 0x1234\n"
+		"Model = alps\n"
+		"MinAccelFactor = 0.25\n"
+		"\n"
+		"[No vendor]\n"
+		"Product=0x0001\n"
+		"\n"
+		"[Named]\n"
+		"Vendor=0x1234\n"
+		"Product=0x5678\n"
+		"Name=*Rev B*\n"
+		"Model=elantech\n"
+		"\n"
+		"[Named later]\n"
+		"Vendor=0x1234\n"
+		"Product=0x5678\n"
+		"Name=* B*\n"
+		"Model=alps\n"
+		"\n"
+		"[Invalid values]\n"
+		"Vendor=0x4321\n"
+		"HistoryLength=100\n"
+		"MaxAccelFactor=1,5\n"
+		"Resolution=40\n"
+		"Unknown=1\n");
+
+	/* Enough entries for the buckets to be shared. */
+	for (i = 1; i <= 200; i++)
+		fprintf(file, "[Many %d]\nVendor=0x1000\nProduct=%d\n"
+			"HistoryLength=%d\n", i, i, 2 + i % 15);
+	fclose(file);
+
+	quirks_init(&li, path);
+	unlink(path);
+
+	defaults = touchpad_quirks_lookup(&li, 0x0001, 0x0001, NULL);
+	ck_assert_int_eq(defaults->model, TOUCHPAD_MODEL_UNKNOWN);
+	ck_assert_int_eq(defaults->history_length, 4);
+	ck_assert_int_eq(defaults->resolution_x, 0);
+
+	quirks = touchpad_quirks_lookup(&li, 0x1234, 0x5678, NULL);
+	ck_assert_int_eq(quirks->model, TOUCHPAD_MODEL_SYNAPTICS);
+	ck_assert_int_eq(quirks->touch_low.offset, 1);
+	ck_assert(quirks->touch_low.fraction == 0.5);
+	ck_assert(quirks->touch_high.fraction == defaults->touch_high.fraction);
+	ck_assert_int_eq(quirks->history_length, 8);
+	ck_assert_int_eq(quirks->resolution_x, 40);
+	ck_assert_int_eq(quirks->resolution_y, 30);
+	ck_assert(quirks->min_accel_factor == defaults->min_accel_factor);
+
+	/* The first matching name pattern wins over no pattern. */
+	quirks = touchpad_quirks_lookup(&li, 0x1234, 0x5678, "Pad Rev B");
+	ck_assert_int_eq(quirks->model, TOUCHPAD_MODEL_ELANTECH);
+	quirks = touchpad_quirks_lookup(&li, 0x1234, 0x5678, "Pad Rev A");
+	ck_assert_int_eq(quirks->model, TOUCHPAD_MODEL_SYNAPTICS);
+
+	quirks = touchpad_quirks_lookup(&li, 0x1234, 0x0001, NULL);
+	ck_assert_int_eq(quirks->model, TOUCHPAD_MODEL_ALPS);
+	ck_assert(quirks->min_accel_factor == 0.25);
+	ck_assert_int_eq(quirks->history_length, 4);
+
+	quirks = touchpad_quirks_lookup(&li, 0x4321, 0x0001, NULL);
+	ck_assert(quirks != defaults);
+	ck_assert_int_eq(quirks->history_length, 4);
+	ck_assert(quirks->max_accel_factor == defaults->max_accel_factor);
+	ck_assert_int_eq(quirks->resolution_x, 0);
+
+	for (i = 1; i <= 200; i++) {
+		quirks = touchpad_quirks_lookup(&li, 0x1000, i, NULL);
+		ck_assert_int_eq(quirks->product, i);
+		ck_assert_int_eq(quirks->history_length, 2 + i % 15);
+	}
+	ck_assert(touchpad_quirks_lookup(&li, 0x1000, 201, NULL) == defaults);
+
+	touchpad_quirks_destroy(&li);
+}
+END_TEST
+
+START_TEST(touchpad_quirks_missing_file)
+{
+	struct libinput li;
+	const struct touchpad_quirks *quirks;
+
+	quirks_init(&li, "/nonexistent/touchpad.quirks");
+
+	quirks = touchpad_quirks_lookup(&li, 0x0002, 0x0007, NULL);
+	ck_assert_int_eq(quirks->model, TOUCHPAD_MODEL_UNKNOWN);
+
+	touchpad_quirks_destroy(&li);
+}
+END_TEST
+
+START_TEST(touchpad_quirks_installed)
+{
+	struct libinput li;
+	const struct touchpad_quirks *quirks;
+
+	/* The file of the source tree, as set up by litest. */
+	quirks_init(&li, getenv(TOUCHPAD_QUIRKS_FILE_ENV));
+
+	quirks = touchpad_quirks_lookup(&li, 0x0002, 0x0007, NULL);
+	ck_assert_int_eq(quirks->model, TOUCHPAD_MODEL_SYNAPTICS);
+
+	quirks = touchpad_quirks_lookup(&li, 0x0002, 0x000e, NULL);
+	ck_assert_int_eq(quirks->model, TOUCHPAD_MODEL_ELANTECH);
+	ck_assert_int_eq(quirks->touch_low.offset, 1);
+	ck_assert(quirks->touch_low.fraction == 0.0);
+
+	quirks = touchpad_quirks_lookup(&li, 0x05ac, 0x0249, NULL);
+	ck_assert_int_eq(quirks->model, TOUCHPAD_MODEL_APPLETOUCH);
+
+	touchpad_quirks_destroy(&li);
+}
+END_TEST
+
+/* Move one finger from 20 mm to 60 mm along the x axis of a touchpad of
+ * the given resolution, and sum the pointer motion. */
+static void
+motion_at_resolution(enum litest_device_type type, int resolution,
+		     const char *quirks, li_fixed_t *dx, li_fixed_t *dy)
+{
+	struct litest_device *dev;
+	struct libinput *li;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	char *saved;
+	int i;
+
+	/* The quirks are read when the context of the device is created. */
+	saved = quirks_file_set(quirks);
+	dev = litest_create_device(type);
+	quirks_file_restore(saved);
+	li = dev->libinput;
+	litest_drain_events(li);
+
+	litest_event(dev, EV_ABS, ABS_MT_SLOT, 0);
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, 1);
+	for (i = 0; i <= 10; i++) {
+		litest_event(dev, EV_ABS, ABS_X, (20 + i * 4) * resolution);
+		litest_event(dev, EV_ABS, ABS_Y, 30 * resolution);
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_X,
+			     (20 + i * 4) * resolution);
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, 30 * resolution);
+		if (i == 0) {
+			litest_event(dev, EV_ABS, ABS_PRESSURE, 60);
+			litest_event(dev, EV_KEY, BTN_TOUCH, 1);
+			litest_event(dev, EV_KEY, BTN_TOOL_FINGER, 1);
+		}
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		usleep(10 * 1000);
+	}
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	litest_event(dev, EV_ABS, ABS_PRESSURE, 0);
+	litest_event(dev, EV_KEY, BTN_TOUCH, 0);
+	litest_event(dev, EV_KEY, BTN_TOOL_FINGER, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+
+	libinput_dispatch(li);
+
+	*dx = 0;
+	*dy = 0;
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_POINTER_MOTION) {
+			ptrev = libinput_event_get_pointer_event(event);
+			*dx += libinput_event_pointer_get_dx(ptrev);
+			*dy += libinput_event_pointer_get_dy(ptrev);
+		}
+		libinput_event_destroy(event);
+	}
+
+	litest_delete_device(dev);
+}
+
+START_TEST(touchpad_motion_resolution)
+{
+	char path[] = "/tmp/litest-quirks-XXXXXX";
+	li_fixed_t low_dx, low_dy, high_dx, high_dy;
+	FILE *file;
+	int fd;
+
+	/* A constant acceleration and no hysteresis or smoothing, so that
+	 * the motion doesn't depend on the timing of the events, and is
+	 * the same to the fixed point precision. */
+	fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	file = fdopen(fd, "w");
+	ck_assert(file != NULL);
+	fprintf(file,
+		"[Resolution]\n"
+		"Vendor=0x06cb\n"
+		"HysteresisMarginDenominator=1000000\n"
+		"MinAccelFactor=0.5\n"
+		"MaxAccelFactor=0.5\n"
+		"HistoryLength=2\n");
+	fclose(file);
+
+	motion_at_resolution(LITEST_TOUCHPAD_RESOLUTION_LOW, 40, path,
+			     &low_dx, &low_dy);
+	motion_at_resolution(LITEST_TOUCHPAD_RESOLUTION_HIGH, 80, path,
+			     &high_dx, &high_dy);
+	unlink(path);
+
+	ck_assert_int_gt(low_dx, 0);
+	ck_assert_int_eq(low_dx, high_dx);
+	ck_assert_int_eq(low_dy, 0);
+	ck_assert_int_eq(high_dy, 0);
+}
+END_TEST
+
+static int
+abs_value(struct litest_device *dev, unsigned int axis, int percent)
+{
+	int min = libevdev_get_abs_minimum(dev->evdev, axis);
+	int max = libevdev_get_abs_maximum(dev->evdev, axis);
+
+	return min + (max - min) * percent / 100;
+}
+
+/* Put two fingers down and scroll with them, leaving them down. */
+static void
+scroll_2fg_move(struct litest_device *dev, int from, int to, int steps,
+		int step_delay)
+{
+	int i, slot, y;
+
+	for (slot = 0; slot < 2; slot++) {
+		litest_event(dev, EV_ABS, ABS_MT_SLOT, slot);
+		litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, slot + 1);
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_X,
+			     abs_value(dev, ABS_MT_POSITION_X, 40 + slot * 20));
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_Y,
+			     abs_value(dev, ABS_MT_POSITION_Y, from));
+	}
+	litest_event(dev, EV_ABS, ABS_PRESSURE, 60);
+	litest_event(dev, EV_KEY, BTN_TOUCH, 1);
+	litest_event(dev, EV_KEY, BTN_TOOL_DOUBLETAP, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+
+	for (i = 1; i <= steps; i++) {
+		y = abs_value(dev, ABS_MT_POSITION_Y,
+			      from + (to - from) * i / steps);
+		for (slot = 0; slot < 2; slot++) {
+			litest_event(dev, EV_ABS, ABS_MT_SLOT, slot);
+			litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, y);
+		}
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+
+		if (step_delay)
+			usleep(step_delay * 1000);
+	}
+}
+
+static void
+scroll_2fg_vertical(struct litest_device *dev, int from, int to, int steps,
+		    int step_delay)
+{
+	int slot;
+
+	scroll_2fg_move(dev, from, to, steps, step_delay);
+
+	for (slot = 0; slot < 2; slot++) {
+		litest_event(dev, EV_ABS, ABS_MT_SLOT, slot);
+		litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	}
+	litest_event(dev, EV_ABS, ABS_PRESSURE, 0);
+	litest_event(dev, EV_KEY, BTN_TOUCH, 0);
+	litest_event(dev, EV_KEY, BTN_TOOL_DOUBLETAP, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+}
+
+START_TEST(touchpad_2fg_scroll)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	int nscroll = 0;
+
+	litest_drain_events(li);
+
+	scroll_2fg_vertical(dev, 30, 70, 10, 0);
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		ck_assert_int_ne(libinput_event_get_type(event),
+				 LIBINPUT_EVENT_POINTER_AXIS);
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_POINTER_SCROLL) {
+			ptrev = libinput_event_get_pointer_event(event);
+			ck_assert_int_eq(
+				libinput_event_pointer_get_scroll_source(ptrev),
+				LIBINPUT_POINTER_SCROLL_SOURCE_FINGER);
+			ck_assert_int_ge(
+				libinput_event_pointer_get_scroll_value(
+					ptrev,
+					LIBINPUT_POINTER_AXIS_VERTICAL_SCROLL),
+				0);
+			ck_assert_int_eq(
+				libinput_event_pointer_get_scroll_value(
+					ptrev,
+					LIBINPUT_POINTER_AXIS_HORIZONTAL_SCROLL),
+				0);
+			nscroll++;
+		}
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_gt(nscroll, 0);
+}
+END_TEST
+
+/* Move the first nfingers fingers to y, the second one to the right of
+ * the first, in one frame. */
+static void
+move_fingers(struct litest_device *dev, int nfingers, int y)
+{
+	int slot;
+
+	for (slot = 0; slot < nfingers; slot++) {
+		litest_event(dev, EV_ABS, ABS_MT_SLOT, slot);
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_X,
+			     abs_value(dev, ABS_MT_POSITION_X, 40 + slot * 20));
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_Y,
+			     abs_value(dev, ABS_MT_POSITION_Y, y));
+	}
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	usleep(10 * 1000);
+}
+
+/* Check that the last frame, which moved down, sent exactly one event of
+ * the given type, and that it moved down too. */
+static void
+assert_frame_moved_down(struct libinput *li, enum libinput_event_type type)
+{
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	int n = 0;
+
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		ck_assert_int_eq(libinput_event_get_type(event), type);
+		ptrev = libinput_event_get_pointer_event(event);
+		if (type == LIBINPUT_EVENT_POINTER_MOTION) {
+			ck_assert_int_eq(libinput_event_pointer_get_dx(ptrev),
+					 0);
+			ck_assert_int_gt(libinput_event_pointer_get_dy(ptrev),
+					 0);
+		} else {
+			ck_assert_int_eq(
+				libinput_event_pointer_get_scroll_value(
+					ptrev,
+					LIBINPUT_POINTER_AXIS_HORIZONTAL_SCROLL),
+				0);
+			ck_assert_int_gt(
+				libinput_event_pointer_get_scroll_value(
+					ptrev,
+					LIBINPUT_POINTER_AXIS_VERTICAL_SCROLL),
+				0);
+		}
+		libinput_event_destroy(event);
+		n++;
+	}
+
+	ck_assert_int_eq(n, 1);
+}
+
+START_TEST(touchpad_finger_count_change)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	int y = 30, i;
+
+	litest_drain_events(li);
+
+	litest_event(dev, EV_ABS, ABS_MT_SLOT, 0);
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, 1);
+	litest_event(dev, EV_ABS, ABS_PRESSURE, 60);
+	litest_event(dev, EV_KEY, BTN_TOUCH, 1);
+	litest_event(dev, EV_KEY, BTN_TOOL_FINGER, 1);
+	move_fingers(dev, 1, y);
+	move_fingers(dev, 1, ++y);
+	litest_drain_events(li);
+
+	for (i = 0; i < 5; i++) {
+		move_fingers(dev, 1, ++y);
+		assert_frame_moved_down(li, LIBINPUT_EVENT_POINTER_MOTION);
+	}
+
+	/* A second finger lands to the side of the first, which keeps
+	 * moving. Its own motion history only starts, so only the first
+	 * finger moves the centroid, and the position of the new finger
+	 * doesn't. */
+	litest_event(dev, EV_ABS, ABS_MT_SLOT, 1);
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, 2);
+	litest_event(dev, EV_KEY, BTN_TOOL_FINGER, 0);
+	litest_event(dev, EV_KEY, BTN_TOOL_DOUBLETAP, 1);
+	move_fingers(dev, 2, ++y);
+	assert_frame_moved_down(li, LIBINPUT_EVENT_POINTER_SCROLL);
+
+	for (i = 0; i < 5; i++) {
+		move_fingers(dev, 2, ++y);
+		assert_frame_moved_down(li, LIBINPUT_EVENT_POINTER_SCROLL);
+	}
+
+	/* The second finger is lifted and the first keeps moving. */
+	litest_event(dev, EV_ABS, ABS_MT_SLOT, 1);
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	litest_event(dev, EV_KEY, BTN_TOOL_DOUBLETAP, 0);
+	litest_event(dev, EV_KEY, BTN_TOOL_FINGER, 1);
+	move_fingers(dev, 1, ++y);
+	assert_frame_moved_down(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	for (i = 0; i < 5; i++) {
+		move_fingers(dev, 1, ++y);
+		assert_frame_moved_down(li, LIBINPUT_EVENT_POINTER_MOTION);
+	}
+
+	litest_event(dev, EV_ABS, ABS_MT_SLOT, 0);
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	litest_event(dev, EV_ABS, ABS_PRESSURE, 0);
+	litest_event(dev, EV_KEY, BTN_TOUCH, 0);
+	litest_event(dev, EV_KEY, BTN_TOOL_FINGER, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+}
+END_TEST
+
+START_TEST(touchpad_2fg_scroll_legacy)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	int naxis = 0;
+
+	libinput_set_legacy_scroll_events(li, 1);
+	litest_drain_events(li);
+
+	scroll_2fg_vertical(dev, 30, 70, 10, 0);
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		ck_assert_int_ne(libinput_event_get_type(event),
+				 LIBINPUT_EVENT_POINTER_SCROLL);
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_POINTER_AXIS) {
+			ptrev = libinput_event_get_pointer_event(event);
+			ck_assert_int_eq(libinput_event_pointer_get_axis(ptrev),
+					 LIBINPUT_POINTER_AXIS_VERTICAL_SCROLL);
+			naxis++;
+		}
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_gt(naxis, 0);
+}
+END_TEST
+
+static struct libinput_event *
+wait_for_event(struct libinput *li)
+{
+	struct pollfd fds;
+	struct libinput_event *event;
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	while (poll(&fds, 1, 1000) > 0) {
+		libinput_dispatch(li);
+		event = libinput_get_event(li);
+		if (event)
+			return event;
+	}
+
+	return NULL;
+}
+
+static struct libinput_event *
+get_device_added_event(struct libinput *li)
+{
+	struct libinput_event *event;
+
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ck_assert(event != NULL);
+	ck_assert_int_eq(libinput_event_get_type(event),
+			 LIBINPUT_EVENT_DEVICE_ADDED);
+
+	return event;
+}
+
+static void
+tap_down(struct litest_device *dev, int x, int y)
+{
+	static int tracking_id;
+
+	litest_event(dev, EV_ABS, ABS_MT_SLOT, 0);
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, ++tracking_id);
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_X,
+		     abs_value(dev, ABS_MT_POSITION_X, x));
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_Y,
+		     abs_value(dev, ABS_MT_POSITION_Y, y));
+	litest_event(dev, EV_ABS, ABS_X, abs_value(dev, ABS_X, x));
+	litest_event(dev, EV_ABS, ABS_Y, abs_value(dev, ABS_Y, y));
+	litest_event(dev, EV_ABS, ABS_PRESSURE, 60);
+	litest_event(dev, EV_KEY, BTN_TOUCH, 1);
+	litest_event(dev, EV_KEY, BTN_TOOL_FINGER, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+}
+
+static void
+tap_move_to(struct litest_device *dev, int from, int to, int steps)
+{
+	int i, x;
+
+	for (i = 1; i <= steps; i++) {
+		x = from + (to - from) * i / steps;
+		litest_event(dev, EV_ABS, ABS_MT_SLOT, 0);
+		litest_event(dev, EV_ABS, ABS_MT_POSITION_X,
+			     abs_value(dev, ABS_MT_POSITION_X, x));
+		litest_event(dev, EV_ABS, ABS_X, abs_value(dev, ABS_X, x));
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+}
+
+static void
+tap_up(struct litest_device *dev)
+{
+	litest_event(dev, EV_ABS, ABS_MT_SLOT, 0);
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	litest_event(dev, EV_ABS, ABS_PRESSURE, 0);
+	litest_event(dev, EV_KEY, BTN_TOUCH, 0);
+	litest_event(dev, EV_KEY, BTN_TOOL_FINGER, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+}
+
+/* Collect the states of the tap button until no more events arrive.
+ * Presses and releases must alternate. Motion events seen while the
+ * button is down are counted in nmotion_pressed, if not NULL. */
+static int
+get_tap_buttons(struct libinput *li,
+		enum libinput_pointer_button_state *states,
+		int max_states,
+		int *nmotion_pressed)
+{
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	enum libinput_pointer_button_state state;
+	int n = 0, pressed = 0;
+
+	if (nmotion_pressed)
+		*nmotion_pressed = 0;
+
+	while ((event = wait_for_event(li))) {
+		switch (libinput_event_get_type(event)) {
+		case LIBINPUT_EVENT_POINTER_BUTTON:
+			ptrev = libinput_event_get_pointer_event(event);
+			ck_assert_int_eq(libinput_event_pointer_get_button(ptrev),
+					 BTN_LEFT);
+			state = libinput_event_pointer_get_button_state(ptrev);
+			ck_assert_int_eq(state == LIBINPUT_POINTER_BUTTON_STATE_PRESSED,
+					 !pressed);
+			pressed = !pressed;
+			if (n < max_states)
+				states[n] = state;
+			n++;
+			break;
+		case LIBINPUT_EVENT_POINTER_MOTION:
+			if (pressed && nmotion_pressed)
+				(*nmotion_pressed)++;
+			break;
+		default:
+			break;
+		}
+		libinput_event_destroy(event);
+	}
+
+	return n;
+}
+
+/* Whether the tap button is held down in a state of the state machine. */
+static int
+fsm_state_pressed(enum fsm_state state)
+{
+	return state == FSM_TAP_PRESSED ||
+	       state == FSM_TAP_2 ||
+	       state == FSM_DRAG;
+}
+
+START_TEST(touchpad_tap_fsm_balanced)
+{
+	static const enum libinput_touchpad_tap_mode modes[] = {
+		LIBINPUT_TOUCHPAD_TAP_DEFERRED,
+		LIBINPUT_TOUCHPAD_TAP_IMMEDIATE,
+	};
+	const struct fsm_transition *transition;
+	unsigned int m, i;
+	int state, event, pressed;
+
+	for (m = 0; m < ARRAY_LENGTH(modes); m++) {
+		for (state = 0; state < FSM_STATE_COUNT; state++) {
+			for (event = 0; event < FSM_EVENT_COUNT; event++) {
+				transition = evdev_touchpad_fsm_transition(
+							state, event, modes[m]);
+				pressed = fsm_state_pressed(state);
+
+				/* Presses and releases alternate, and leave
+				 * the button as the next state holds it. */
+				for (i = 0; i < FSM_MAX_ACTIONS; i++) {
+					switch (transition->actions[i]) {
+					case FSM_ACTION_PRESS:
+						ck_assert(!pressed);
+						pressed = 1;
+						break;
+					case FSM_ACTION_RELEASE:
+						ck_assert(pressed);
+						pressed = 0;
+						break;
+					default:
+						break;
+					}
+				}
+
+				ck_assert(transition->next < FSM_STATE_COUNT);
+				ck_assert_int_eq(pressed,
+						 fsm_state_pressed(
+							transition->next));
+			}
+		}
+	}
+}
+END_TEST
+
+START_TEST(touchpad_tap_config)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_event *event = get_device_added_event(dev->libinput);
+	struct libinput_device *device = libinput_event_get_device(event);
+
+	ck_assert_int_eq(libinput_device_touchpad_set_tap(
+				device, LIBINPUT_TOUCHPAD_TAP_IMMEDIATE, 150),
+			 0);
+	ck_assert_int_eq(libinput_device_touchpad_set_tap(
+				device, LIBINPUT_TOUCHPAD_TAP_DEFERRED, 0),
+			 0);
+
+	libinput_event_destroy(event);
+}
+END_TEST
+
+START_TEST(touchpad_tap_config_not_touchpad)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_event *event = get_device_added_event(dev->libinput);
+	struct libinput_device *device = libinput_event_get_device(event);
+
+	ck_assert_int_eq(libinput_device_touchpad_set_tap(
+				device, LIBINPUT_TOUCHPAD_TAP_IMMEDIATE, 0),
+			 -1);
+
+	libinput_event_destroy(event);
+}
+END_TEST
+
+START_TEST(touchpad_1fg_tap)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	enum libinput_pointer_button_state states[2];
+
+	litest_drain_events(li);
+
+	tap_down(dev, 50, 50);
+	tap_up(dev);
+
+	/* The click is only sent once no second touch followed. */
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ck_assert(event == NULL);
+
+	ck_assert_int_eq(get_tap_buttons(li, states, 2, NULL), 2);
+	ck_assert_int_eq(states[0], LIBINPUT_POINTER_BUTTON_STATE_PRESSED);
+	ck_assert_int_eq(states[1], LIBINPUT_POINTER_BUTTON_STATE_RELEASED);
+}
+END_TEST
+
+START_TEST(touchpad_1fg_tap_immediate)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_device *device;
+	struct libinput_event_pointer *ptrev;
+	enum libinput_pointer_button_state states[2];
+
+	event = get_device_added_event(li);
+	device = libinput_event_get_device(event);
+	ck_assert_int_eq(libinput_device_touchpad_set_tap(
+				device, LIBINPUT_TOUCHPAD_TAP_IMMEDIATE, 0),
+			 0);
+	libinput_event_destroy(event);
+	litest_drain_events(li);
+
+	/* The button is pressed when the finger is lifted, before the
+	 * timeout, and released when the timeout expires. */
+	tap_down(dev, 50, 50);
+	tap_up(dev);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ck_assert(event != NULL);
+	ck_assert_int_eq(libinput_event_get_type(event),
+			 LIBINPUT_EVENT_POINTER_BUTTON);
+	ptrev = libinput_event_get_pointer_event(event);
+	ck_assert_int_eq(libinput_event_pointer_get_button_state(ptrev),
+			 LIBINPUT_POINTER_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+
+	ck_assert(libinput_get_event(li) == NULL);
+	event = wait_for_event(li);
+	ck_assert(event != NULL);
+	ck_assert_int_eq(libinput_event_get_type(event),
+			 LIBINPUT_EVENT_POINTER_BUTTON);
+	ptrev = libinput_event_get_pointer_event(event);
+	ck_assert_int_eq(libinput_event_pointer_get_button_state(ptrev),
+			 LIBINPUT_POINTER_BUTTON_STATE_RELEASED);
+	libinput_event_destroy(event);
+
+	/* Back in the default mode, nothing is sent until the timeout. */
+	ck_assert_int_eq(libinput_device_touchpad_set_tap(
+				device, LIBINPUT_TOUCHPAD_TAP_DEFERRED, 0),
+			 0);
+	tap_down(dev, 50, 50);
+	tap_up(dev);
+	libinput_dispatch(li);
+	ck_assert(libinput_get_event(li) == NULL);
+
+	ck_assert_int_eq(get_tap_buttons(li, states, 2, NULL), 2);
+	ck_assert_int_eq(states[0], LIBINPUT_POINTER_BUTTON_STATE_PRESSED);
+}
+END_TEST
+
+START_TEST(touchpad_1fg_tap_motion)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	enum libinput_pointer_button_state states[2];
+
+	litest_drain_events(li);
+
+	tap_down(dev, 50, 50);
+	tap_move_to(dev, 50, 80, 10);
+	tap_up(dev);
+
+	ck_assert_int_eq(get_tap_buttons(li, states, 2, NULL), 0);
+}
+END_TEST
+
+START_TEST(touchpad_1fg_double_tap)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	enum libinput_pointer_button_state states[4];
+
+	litest_drain_events(li);
+
+	tap_down(dev, 50, 50);
+	tap_up(dev);
+	tap_down(dev, 50, 50);
+	tap_up(dev);
+
+	/* Two clicks, with the button released in between. */
+	ck_assert_int_eq(get_tap_buttons(li, states, 4, NULL), 4);
+	ck_assert_int_eq(states[3], LIBINPUT_POINTER_BUTTON_STATE_RELEASED);
+}
+END_TEST
+
+START_TEST(touchpad_1fg_tap_drag)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	enum libinput_pointer_button_state states[2];
+	int nmotion;
+
+	litest_drain_events(li);
+
+	tap_down(dev, 50, 50);
+	tap_up(dev);
+	tap_down(dev, 50, 50);
+	tap_move_to(dev, 50, 80, 10);
+	tap_up(dev);
+
+	/* The button is held during the motion and released exactly once,
+	 * when the finger is lifted. */
+	ck_assert_int_eq(get_tap_buttons(li, states, 2, &nmotion), 2);
+	ck_assert_int_eq(states[1], LIBINPUT_POINTER_BUTTON_STATE_RELEASED);
+	ck_assert_int_gt(nmotion, 0);
+}
+END_TEST
+
+START_TEST(touchpad_1fg_tap_clickpad)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	enum libinput_pointer_button_state states[2];
+
+	litest_drain_events(li);
+
+	tap_down(dev, 50, 50);
+	tap_up(dev);
+
+	ck_assert_int_eq(get_tap_buttons(li, states, 2, NULL), 0);
+}
+END_TEST
+
+START_TEST(touchpad_kinetic_scroll)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	enum libinput_pointer_scroll_source source = 0;
+
+	event = get_device_added_event(li);
+	ck_assert_int_eq(libinput_device_touchpad_set_kinetic_scroll(
+				libinput_event_get_device(event), 100),
+			 0);
+	libinput_event_destroy(event);
+	litest_drain_events(li);
+
+	scroll_2fg_vertical(dev, 20, 80, 10, 10);
+
+	/* Scrolling continues after the fingers were lifted. */
+	while ((event = wait_for_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_POINTER_SCROLL) {
+			ptrev = libinput_event_get_pointer_event(event);
+			source = libinput_event_pointer_get_scroll_source(ptrev);
+			if (source == LIBINPUT_POINTER_SCROLL_SOURCE_KINETIC)
+				ck_assert_int_gt(
+					libinput_event_pointer_get_scroll_value(
+					      ptrev,
+					      LIBINPUT_POINTER_AXIS_VERTICAL_SCROLL),
+					0);
+		}
+		libinput_event_destroy(event);
+
+		if (source == LIBINPUT_POINTER_SCROLL_SOURCE_KINETIC)
+			break;
+	}
+
+	ck_assert_int_eq(source, LIBINPUT_POINTER_SCROLL_SOURCE_KINETIC);
+
+	/* A new touch stops it. */
+	litest_event(dev, EV_ABS, ABS_PRESSURE, 60);
+	litest_event(dev, EV_KEY, BTN_TOUCH, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+	ck_assert(wait_for_event(li) == NULL);
+}
+END_TEST
+
+START_TEST(touchpad_kinetic_scroll_staggered_lift)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	enum libinput_pointer_scroll_source source = 0;
+	int x = abs_value(dev, ABS_MT_POSITION_X, 40);
+	int y = abs_value(dev, ABS_MT_POSITION_Y, 80);
+
+	event = get_device_added_event(li);
+	ck_assert_int_eq(libinput_device_touchpad_set_kinetic_scroll(
+				libinput_event_get_device(event), 100),
+			 0);
+	libinput_event_destroy(event);
+	litest_drain_events(li);
+
+	scroll_2fg_move(dev, 20, 80, 10, 10);
+
+	/* The second finger is lifted first, and the remaining one moves
+	 * a little on its own before it is lifted too. */
+	litest_event(dev, EV_ABS, ABS_MT_SLOT, 1);
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	litest_event(dev, EV_ABS, ABS_MT_SLOT, 0);
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_X, x + 2);
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, y + 2);
+	litest_event(dev, EV_KEY, BTN_TOOL_DOUBLETAP, 0);
+	litest_event(dev, EV_KEY, BTN_TOOL_FINGER, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	usleep(20 * 1000);
+
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_X, x + 4);
+	litest_event(dev, EV_ABS, ABS_MT_POSITION_Y, y + 4);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	usleep(20 * 1000);
+
+	litest_event(dev, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	litest_event(dev, EV_ABS, ABS_PRESSURE, 0);
+	litest_event(dev, EV_KEY, BTN_TOUCH, 0);
+	litest_event(dev, EV_KEY, BTN_TOOL_FINGER, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+
+	/* Scrolling still continues after the last finger was lifted. */
+	while ((event = wait_for_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_POINTER_SCROLL) {
+			ptrev = libinput_event_get_pointer_event(event);
+			source = libinput_event_pointer_get_scroll_source(ptrev);
+			if (source == LIBINPUT_POINTER_SCROLL_SOURCE_KINETIC)
+				ck_assert_int_gt(
+					libinput_event_pointer_get_scroll_value(
+					      ptrev,
+					      LIBINPUT_POINTER_AXIS_VERTICAL_SCROLL),
+					0);
+		}
+		libinput_event_destroy(event);
+
+		if (source == LIBINPUT_POINTER_SCROLL_SOURCE_KINETIC)
+			break;
+	}
+
+	ck_assert_int_eq(source, LIBINPUT_POINTER_SCROLL_SOURCE_KINETIC);
+}
+END_TEST
+
+int main (int argc, char **argv) {
+
+	litest_add("touchpad:motion", touchpad_1fg_motion, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add_no_device("touchpad:motion", touchpad_estimate_delta);
+	litest_add_no_device("touchpad:motion", touchpad_motion_resolution);
+	litest_add_no_device("touchpad:quirks", touchpad_quirks_file);
+	litest_add_no_device("touchpad:quirks", touchpad_quirks_missing_file);
+	litest_add_no_device("touchpad:quirks", touchpad_quirks_installed);
+	litest_add("touchpad:scroll", touchpad_2fg_scroll, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:scroll", touchpad_2fg_scroll_legacy, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:scroll", touchpad_finger_count_change, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:scroll", touchpad_kinetic_scroll, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:scroll", touchpad_kinetic_scroll_staggered_lift, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:tap", touchpad_1fg_tap, LITEST_TOUCHPAD, LITEST_CLICKPAD);
+	litest_add("touchpad:tap", touchpad_1fg_tap_immediate, LITEST_TOUCHPAD, LITEST_CLICKPAD);
+	litest_add("touchpad:tap", touchpad_1fg_tap_motion, LITEST_TOUCHPAD, LITEST_CLICKPAD);
+	litest_add("touchpad:tap", touchpad_1fg_double_tap, LITEST_TOUCHPAD, LITEST_CLICKPAD);
+	litest_add("touchpad:tap", touchpad_1fg_tap_drag, LITEST_TOUCHPAD, LITEST_CLICKPAD);
+	litest_add("touchpad:tap", touchpad_1fg_tap_clickpad, LITEST_CLICKPAD, LITEST_ANY);
+	litest_add_no_device("touchpad:tap", touchpad_tap_fsm_balanced);
+	litest_add("touchpad:tap", touchpad_tap_config, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:tap", touchpad_tap_config_not_touchpad, LITEST_ANY, LITEST_TOUCHPAD);
+
+	return litest_run(argc, argv);
+}
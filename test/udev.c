@@ -27,8 +27,10 @@
 #include <fcntl.h>
 #include <libinput.h>
 #include <libudev.h>
+#include <pthread.h>
 #include <unistd.h>
 
+#include "evdev.h"
 #include "litest.h"
 
 static int open_restricted(const char *path, int flags, void *data)
@@ -47,6 +49,26 @@ const struct libinput_interface simple_interface = {
 	.close_restricted = close_restricted,
 };
 
+/* Counts the opens in the int user_data points to. Called from the open
+ * threads of a threaded context. */
+static pthread_mutex_t open_count_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int counting_open_restricted(const char *path, int flags, void *data)
+{
+	int *count = data;
+
+	pthread_mutex_lock(&open_count_lock);
+	(*count)++;
+	pthread_mutex_unlock(&open_count_lock);
+
+	return open_restricted(path, flags, data);
+}
+
+const struct libinput_interface counting_interface = {
+	.open_restricted = counting_open_restricted,
+	.close_restricted = close_restricted,
+};
+
 
 START_TEST(udev_create_NULL)
 {
@@ -102,6 +124,53 @@ START_TEST(udev_create_seat0)
 }
 END_TEST
 
+START_TEST(udev_create_seat0_threaded)
+{
+	struct libinput *li, *li_threaded;
+	struct libinput_event *event, *event_threaded;
+	struct udev *udev;
+	int nopened = 0, nopened_threaded = 0;
+
+	udev = udev_new();
+	ck_assert(udev != NULL);
+
+	li = libinput_create_from_udev(&counting_interface, &nopened,
+				       udev, "seat0");
+	ck_assert(li != NULL);
+	li_threaded = libinput_create_from_udev_threaded(&counting_interface,
+							 &nopened_threaded,
+							 udev, "seat0", 4);
+	ck_assert(li_threaded != NULL);
+
+	/* devices are added in the same order as when opened sequentially */
+	libinput_dispatch(li);
+	libinput_dispatch(li_threaded);
+	while ((event = libinput_get_event(li))) {
+		event_threaded = libinput_get_event(li_threaded);
+		ck_assert(event_threaded != NULL);
+		ck_assert_int_eq(libinput_event_get_type(event),
+				 libinput_event_get_type(event_threaded));
+		ck_assert_str_eq(
+			libinput_device_get_sysname(
+				libinput_event_get_device(event)),
+			libinput_device_get_sysname(
+				libinput_event_get_device(event_threaded)));
+
+		libinput_event_destroy(event);
+		libinput_event_destroy(event_threaded);
+	}
+	ck_assert(libinput_get_event(li_threaded) == NULL);
+
+	/* the devices present at creation were opened once, with threads,
+	 * not sequentially first */
+	ck_assert_int_eq(nopened_threaded, nopened);
+
+	libinput_destroy(li);
+	libinput_destroy(li_threaded);
+	udev_unref(udev);
+}
+END_TEST
+
 START_TEST(udev_create_empty_seat)
 {
 	struct libinput *li;
@@ -294,10 +363,65 @@ START_TEST(udev_suspend_resume)
 }
 END_TEST
 
+START_TEST(udev_classify_handled)
+{
+	/* not processed by udev, or not classified by it */
+	ck_assert(evdev_udev_tags_is_handled(0));
+	ck_assert(evdev_udev_tags_is_handled(EVDEV_UDEV_TAG_INPUT));
+
+	ck_assert(evdev_udev_tags_is_handled(EVDEV_UDEV_TAG_INPUT |
+					     EVDEV_UDEV_TAG_KEYBOARD));
+	ck_assert(!evdev_udev_tags_is_handled(EVDEV_UDEV_TAG_INPUT |
+					      EVDEV_UDEV_TAG_JOYSTICK));
+	ck_assert(!evdev_udev_tags_is_handled(EVDEV_UDEV_TAG_INPUT |
+					      EVDEV_UDEV_TAG_ACCELEROMETER));
+	ck_assert(evdev_udev_tags_is_handled(EVDEV_UDEV_TAG_INPUT |
+					     EVDEV_UDEV_TAG_KEY |
+					     EVDEV_UDEV_TAG_JOYSTICK));
+}
+END_TEST
+
+START_TEST(udev_classify_touchpad)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct evdev_device *device = NULL;
+	enum evdev_device_udev_tags tags;
+
+	libinput_dispatch(li);
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_DEVICE_ADDED)
+			device = (struct evdev_device *)
+				libinput_event_get_device(event);
+		libinput_event_destroy(event);
+	}
+	ck_assert(device != NULL);
+
+	tags = device->udev_tags;
+
+	/* without a udev classification, the evdev bits decide */
+	device->udev_tags = 0;
+	ck_assert(evdev_device_is_touchpad(device));
+	device->udev_tags = EVDEV_UDEV_TAG_INPUT;
+	ck_assert(evdev_device_is_touchpad(device));
+
+	/* otherwise udev does */
+	device->udev_tags = EVDEV_UDEV_TAG_INPUT | EVDEV_UDEV_TAG_MOUSE;
+	ck_assert(!evdev_device_is_touchpad(device));
+	device->udev_tags = EVDEV_UDEV_TAG_INPUT | EVDEV_UDEV_TAG_TOUCHPAD;
+	ck_assert(evdev_device_is_touchpad(device));
+
+	device->udev_tags = tags;
+}
+END_TEST
+
 int main (int argc, char **argv) {
 
 	litest_add_no_device("udev:create", udev_create_NULL);
 	litest_add_no_device("udev:create", udev_create_seat0);
+	litest_add_no_device("udev:create", udev_create_seat0_threaded);
 	litest_add_no_device("udev:create", udev_create_empty_seat);
 
 	litest_add_no_device("udev:seat events", udev_added_seat_default);
@@ -306,5 +430,8 @@ int main (int argc, char **argv) {
 	litest_add("udev:suspend", udev_double_resume, LITEST_ANY, LITEST_ANY);
 	litest_add("udev:suspend", udev_suspend_resume, LITEST_ANY, LITEST_ANY);
 
+	litest_add_no_device("udev:classify", udev_classify_handled);
+	litest_add("udev:classify", udev_classify_touchpad, LITEST_TOUCHPAD, LITEST_ANY);
+
 	return litest_run(argc, argv);
 }